@@ -41,8 +41,8 @@ namespace util {
 
     ////////////////////////////////////////////////////////////////////////////////////
 
-    BitStreamWriter::BitStreamWriter(size_t s)
-        : BitStream(util::allocArray<uint8_t>(s), s, 0, true)
+    BitStreamWriter::BitStreamWriter(size_t s, uint8_t flags)
+        : BitStream(util::allocPlane<uint8_t>(s, flags), s, 0, true)
     {
         //printf("Allocated buffer of size: %d\n", s);
     }
@@ -58,15 +58,21 @@ namespace util {
         }
     }
 
-    void BitStreamWriter::put_bit(int8_t value) {
-        const size_t bits_taken = this->position % 8;
+    void BitStreamWriter::put_bit_at(size_t position, int8_t value) {
+        const size_t bits_taken = position % 8;
 
-        if (value) {
-            this->buffer[this->position / 8] |= 1 << (7 - bits_taken);
+        if (bits_taken == 0) {
+            // First bit of a new byte, clear the rest of it as well
+            this->buffer[position / 8] = value ? 0x80 : 0x00;
+        } else if (value) {
+            this->buffer[position / 8] |= 1 << (7 - bits_taken);
         } else {
-            this->buffer[this->position / 8] &= ~(1 << (7 - bits_taken));
+            this->buffer[position / 8] &= ~(1 << (7 - bits_taken));
         }
+    }
 
+    void BitStreamWriter::put_bit(int8_t value) {
+        this->put_bit_at(this->position, value);
         this->position++;
     }
 
@@ -76,6 +82,75 @@ namespace util {
         }
     }
 
+    void BitStreamWriter::splice(size_t offset, const BitStreamWriter &piece) {
+        const uint8_t *src   = piece.get_buffer();
+        const size_t   end   = offset + piece.get_position();
+        const size_t   first = util::round_to_byte(offset);   ///< First byte completely inside the piece
+        const size_t   last  = end / 8;                        ///< Byte after the last one completely inside the piece
+        const size_t   shift = (first * 8 - offset) % 8;       ///< Bit offset in src of every destination byte
+
+        for (size_t byte = first; byte < last; byte++) {
+            const size_t s = (byte * 8 - offset) / 8;
+
+            this->buffer[byte] = shift ? uint8_t((src[s] << shift) | (src[s + 1] >> (8 - shift)))
+                                       : src[s];
+        }
+    }
+
+    void BitStreamWriter::splice_edges(size_t offset, const BitStreamWriter &piece) {
+        const uint8_t *src   = piece.get_buffer();
+        const size_t   end   = offset + piece.get_position();
+        const size_t   first = std::min(util::round_to_byte(offset) * 8, end);
+        const size_t   last  = std::max((end / 8) * 8, first);
+
+        for (size_t p = offset; p < first; p++) {
+            this->put_bit_at(p, (src[(p - offset) / 8] >> (7 - (p - offset) % 8)) & 1);
+        }
+
+        for (size_t p = last; p < end; p++) {
+            this->put_bit_at(p, (src[(p - offset) / 8] >> (7 - (p - offset) % 8)) & 1);
+        }
+    }
+
+    void BitStreamWriter::copy_bits(const uint8_t *src, size_t src_position, size_t length) {
+        const size_t end = src_position + length;
+
+        // Up to the next byte boundary of this stream
+        while (src_position < end && this->position % 8 != 0) {
+            this->put_bit((src[src_position / 8] >> (7 - src_position % 8)) & 1);
+            src_position++;
+        }
+
+        const size_t  bytes = (end - src_position) / 8;
+        const uint8_t shift = src_position % 8;
+        const uint8_t *s    = src + src_position / 8;
+        uint8_t       *dst  = this->buffer + this->position / 8;
+
+        for (size_t b = 0; b < bytes; b++) {
+            dst[b] = shift ? uint8_t((s[b] << shift) | (s[b + 1] >> (8 - shift))) : s[b];
+        }
+
+        src_position   += bytes * 8;
+        this->position += bytes * 8;
+
+        while (src_position < end) {
+            this->put_bit((src[src_position / 8] >> (7 - src_position % 8)) & 1);
+            src_position++;
+        }
+    }
+
+    void BitStreamWriter::drain(std::ofstream &fs) {
+        const size_t whole_bytes = this->position / 8;
+
+        fs.write(reinterpret_cast<const char*>(this->buffer), std::streamsize(whole_bytes));
+
+        if (this->position % 8 != 0) {
+            this->buffer[0] = this->buffer[whole_bytes];
+        }
+
+        this->position %= 8;
+    }
+
     void write(FILE *f, const BitStreamWriter &b) {
         const size_t position = b.get_position();
         const uint8_t *buffer = b.get_buffer();
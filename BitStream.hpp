@@ -22,7 +22,7 @@ namespace util {
 
             ~BitStream(void) {
                 if (this->managed) {
-                    util::deallocArray(this->buffer);
+                    util::deallocPlane(this->buffer);
                 }
             }
 
@@ -78,7 +78,8 @@ namespace util {
                         return this->get_size();
                     }
 
-                    util::reallocArray(this->buffer, this->size, new_size);
+                    // Writers only append, so the new part needs no initialisation
+                    util::reallocPlane(this->buffer, this->size, new_size, util::PLANE_UNINITIALISED);
                 }
 
                 return this->get_size();
@@ -139,10 +140,13 @@ namespace util {
 
             /**
              * Create a bitstreamwriter and allocate a buffer for it.
+             * Every byte is fully written when its first bit is put,
+             * so only buffers that are read before being written need zero-initialisation.
              *
              * @param [in] size The size (expressed in bytes) of the buffer into which bits will be written.
+             * @param [in] flags A combination of util::PlaneFlag values for the buffer.
              */
-            BitStreamWriter(size_t s);
+            BitStreamWriter(size_t s, uint8_t flags = util::PLANE_ZEROED);
 
             ~BitStreamWriter();
 
@@ -168,6 +172,43 @@ namespace util {
              * Byte-align: Move the bitwise position pointer to the next byte boundary
              */
             void flush();
+
+            /**
+             * Copy the bits of piece into this bitstream at bit position offset, without moving the position.
+             * Only the bytes completely covered by the piece are written, so pieces at different
+             * offsets can be spliced concurrently. Call splice_edges() afterwards for the other bits.
+             *
+             * @param [in] offset The bit position to copy the bits of piece to.
+             * @param [in] piece The bitstream to copy, from its start up to its position.
+             */
+            void splice(size_t offset, const BitStreamWriter &piece);
+
+            /**
+             * Copy the bits of piece at offset that share a byte with another piece, see splice().
+             * Pieces must be passed in order of offset, just like bits are put in order.
+             */
+            void splice_edges(size_t offset, const BitStreamWriter &piece);
+
+            /**
+             * Append 'length' bits of another buffer, starting at any bit position in that buffer.
+             * Whole bytes are copied (shifted if the positions are not aligned), so long ranges are fast.
+             *
+             * @param [in] src The buffer to copy from.
+             * @param [in] src_position The bit position of the first bit to copy in src.
+             * @param [in] length The amount of bits to copy.
+             */
+            void copy_bits(const uint8_t *src, size_t src_position, size_t length);
+
+            /**
+             * Write every whole byte up to the position to the file stream and move the
+             * remaining bits to the start of the buffer, so a stream can be written in parts.
+             *
+             * @param [in] fs The file stream to write to.
+             */
+            void drain(std::ofstream &fs);
+
+        private:
+            void put_bit_at(size_t position, int8_t value);
     };
 
     /**
@@ -2,12 +2,19 @@
 #include "main.hpp"
 #include "Logger.hpp"
 #include "utils.hpp"
+#include "Transform.hpp"
 
 #include <algorithm>
 #include <functional>
 #include <numeric>
 #include <limits>
 #include <cmath>
+#include <cstring>
+#include <cassert>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
 
 #include "Frame.hpp"
 
@@ -19,60 +26,86 @@
 
 /**
  *  Template specification.
- *  Specify the template class to use dc::BlockSize as default <size>.
+ *  Every supported block size (see dc::isSupportedBlockSize) is instantiated,
+ *  dc::MacroBlockSize is included as 16.
  */
-template class dc::Block<dc::BlockSize>;
-template class dc::Block<dc::MacroBlockSize>;
+template class dc::Block< 4u>;
+template class dc::Block< 8u>;
+template class dc::Block<16u>;
+
+template class dc::BlockPlane< 4u>;
+template class dc::BlockPlane< 8u>;
+template class dc::BlockPlane<16u>;
 
-/**
- *  @brief  Lookup table (vector) for zig-zag indices.
- */
-static std::vector<algo::Position_t> BlockZigZagLUT;
 static algo::MER_level_t BlockMERLUT;
 
 
 /**
  *  @brief  Default ctor
  *
- *  @param  row_offset_list
- *      This should be an array of length <size> with pointers to the
- *      start of each row for a Block inside a byte stream.
- *
- *      The values from the stream will be copied row-by-row to an internal
- *      array of doubles for calculation.
+ *  @param  view
+ *      The pixels of the Block inside the image plane.
+ *      The values will be copied row-by-row to the coefficients,
+ *      the transform converts them to doubles for calculation.
+ *  @param  coefficients
+ *      Storage for (size*size) coefficients, see dc::BlockPlane.
+ *  @param  rle
+ *      Storage for the RLE sequence, at least dc::Block<size>::RLE_CAPACITY elements.
  */
 template<size_t size>
-dc::Block<size>::Block(uint8_t *row_offset_list[])
-    : matrix{nullptr}
-    , expanded{0.0}
-    , rle_Data(nullptr)
+dc::Block<size>::Block(const dc::BlockView &view, int16_t *coefficients, algo::RLE_data_t *rle)
+    : view(view)
+    , expanded(coefficients)
+    , rle_Data(rle)
+    , rle_length(0u)
+    , coded(size * size)
+    , mvec_this{0, int32_t(view.x), int32_t(view.y), nullptr}
+    , mvec{0, 0, 0, nullptr}
 {
-    this->updateRows(row_offset_list);
+    const size_t n = size / view.scale;
 
-    for (size_t y = 0; y < size; y++) {
-        std::copy_n(this->matrix[y], size, &this->expanded[y * size]);
+    for (size_t y = 0; y < n; y++) {
+        std::copy_n(this->view.row(y), n, &this->expanded[y * size]);
     }
 }
 
 /**
  *  @brief  Default ctor for Macroblock
  *
- *  @param  row_offset_list
- *      This should be an array of length <size> with pointers to the
- *      start of each row for a Block inside a byte stream.
- *
- *      The values from the stream will be copied row-by-row to an internal
- *      array of doubles for calculation.
+ *  @param  view
+ *      The pixels of the Block inside the frame,
+ *      its top-left corner is the position of the Block for motion estimation.
+ *  @param  coefficients
+ *      Storage for (size*size) coefficients, see dc::BlockPlane.
+ *      Can be nullptr for a reference MacroBlock that is only compared against.
  */
 template<size_t size>
-dc::Block<size>::Block(uint8_t *row_offset_list[], int16_t x, int16_t y)
-    : matrix{nullptr}
-    , expanded{0.0}
+dc::Block<size>::Block(const dc::BlockView &view, int16_t *coefficients)
+    : view(view)
+    , expanded(coefficients)
     , rle_Data(nullptr)
-    , mvec_this{0, x, y, nullptr}
+    , rle_length(0u)
+    , coded(size * size)
+    , mvec_this{0, int32_t(view.x), int32_t(view.y), nullptr}
     , mvec{0, 0, 0, nullptr}
 {
-    this->updateRows(row_offset_list);
+    // Empty
+}
+
+/**
+ *  @brief  Move ctor, the storage stays owned by the dc::BlockPlane.
+ */
+template<size_t size>
+dc::Block<size>::Block(dc::Block<size>&& other) noexcept
+    : view(other.view)
+    , expanded(other.expanded)
+    , rle_Data(other.rle_Data)
+    , rle_length(other.rle_length)
+    , coded(other.coded)
+    , mvec_this(other.mvec_this)
+    , mvec(other.mvec)
+{
+    // Empty
 }
 
 /**
@@ -80,155 +113,543 @@ dc::Block<size>::Block(uint8_t *row_offset_list[], int16_t x, int16_t y)
  */
 template<size_t size>
 dc::Block<size>::~Block() {
-    if (this->rle_Data != nullptr) {
-        util::deallocVector(this->rle_Data);
-    }
+    // Empty
 }
 
-template<size_t size>
-void dc::Block<size>::updateRows(uint8_t *row_offset_list[]) {
-    std::copy_n(row_offset_list, size, this->matrix);
+/**
+ *  @brief  Default ctor
+ *
+ *  @param  capacity
+ *      The maximum amount of Blocks in the plane.
+ *      The coefficients and RLE sequences are allocated at once as planes (not initialised,
+ *      huge pages for large planes, see util::allocPlane()).
+ */
+template<size_t bsize>
+dc::BlockPlane<bsize>::BlockPlane(const size_t capacity)
+    : capacity(capacity)
+    , coefficients(util::allocPlane<int16_t>(capacity * bsize * bsize,
+                                             util::PLANE_UNINITIALISED | util::PLANE_HUGE_PAGES))
+    , rle(util::allocPlane<algo::RLE_data_t>(capacity * dc::Block<bsize>::RLE_CAPACITY,
+                                             util::PLANE_UNINITIALISED | util::PLANE_HUGE_PAGES))
+{
+    this->blocks.reserve(capacity);
+}
+
+/**
+ *  @brief  Default dtor
+ */
+template<size_t bsize>
+dc::BlockPlane<bsize>::~BlockPlane(void) {
+    this->blocks.clear();
+    util::deallocPlane(this->coefficients);
+    util::deallocPlane(this->rle);
 }
 
 /**
- *  @brief  Copy the internal double data back into the original stream as bytes.
+ *  @brief  Add a Block with the next free coefficients and RLE storage, see Block(const BlockView&, int16_t*, algo::RLE_data_t*).
+ */
+template<size_t bsize>
+dc::Block<bsize>& dc::BlockPlane<bsize>::add(const dc::BlockView &view) {
+    assert(this->blocks.size() < this->capacity);
+    const size_t id = this->blocks.size();
+    return this->blocks.emplace_back(view, this->getCoefficients(id), this->getRLE(id));
+}
+
+/**
+ *  @brief  Add a MacroBlock with the next free coefficients, see Block(const BlockView&, int16_t*).
+ *          MacroBlocks are not RLE encoded, so they get no RLE storage.
+ */
+template<size_t bsize>
+dc::Block<bsize>& dc::BlockPlane<bsize>::addMacroBlock(const dc::BlockView &view) {
+    assert(this->blocks.size() < this->capacity);
+    return this->blocks.emplace_back(view, this->getCoefficients(this->blocks.size()));
+}
+
+/**
+ *  @brief  Copy the internal coefficient data back into the original stream as bytes.
  *          (all size*size elements, so only when decoding)
  *
  *          Clamp the results to fit inside a byte.
  */
 template<size_t size>
 void dc::Block<size>::expand(void) const {
-    for (size_t y = 0; y < size; y++) {
+    uint8_t *row = this->view.row(0);
+
+    for (size_t y = 0; y < size; y++, row += this->view.stride) {
         for (size_t x = 0; x < size; x++) {
-            this->matrix[y][x] = uint8_t(std::clamp(this->expanded[y * size + x], 0.0, 255.0));
+            row[x] = uint8_t(std::clamp<int16_t>(this->expanded[y * size + x], 0, 255));
         }
-//        std::copy_n(&this->expanded[y * size], size, this->matrix[y]);
     }
 }
 
 
 template<size_t size>
 void dc::Block<size>::expandDifferences(void) const {
-    for (size_t y = 0; y < size; y++) {
+    uint8_t *row = this->view.row(0);
+
+    for (size_t y = 0; y < size; y++, row += this->view.stride) {
         for (size_t x = 0; x < size; x++) {
-            this->matrix[y][x] = uint8_t(std::clamp(this->matrix[y][x]
-                                                     + this->expanded[y * size + x],
-                                                    0.0, 255.0));
+            row[x] = uint8_t(std::clamp(int32_t(row[x]) + this->expanded[y * size + x], 0, 255));
         }
     }
 }
 
+/**
+ *  @brief  Overwrite the pixels of this Block with the pixels in other.
+ */
 template<size_t size>
-void dc::Block<size>::copyBlockMatrixTo(dc::Block<size>& other) const {
-    // Write this->matrix to other.matrix
+void dc::Block<size>::copyMatrixFrom(const dc::BlockView& other) {
+    const uint8_t *src = other.row(0);
+          uint8_t *dst = this->view.row(0);
 
-    for (size_t y = 0; y < size; y++) {
-        std::copy_n(this->matrix[y], size, other.getRow(y));
+    for (size_t y = 0; y < size; y++, src += other.stride, dst += this->view.stride) {
+        std::copy_n(src, size, dst);
     }
 }
 
 /**
  *  @brief  Perform forward DCT on the Block data.
  *
- *          Subtract 128 from every value (if enabled) to make the
+ *          Load the coefficients into a double buffer,
+ *          subtract 128 from every value (if enabled) to make the
  *          resulting DCT components smaller,
  *          call transformDCT on the data,
- *          then divide each element with the quant_matrix.
+ *          then divide each element with the quant_matrix and store it rounded.
+ *
+ *          The coefficients are stored in zig-zag order, so m must be in zig-zag order too
+ *          (see MatrixReader::getZigzagData()) and RLE can scan them linearly.
  */
 template<size_t size>
 void dc::Block<size>::processDCTDivQ(const double m[]) {
+    alignas(dc::BlockPlane<size>::ALIGNMENT) double data[size * size];
+
+    std::copy_n(this->expanded, size * size, data);
+
     #ifdef SUBTRACT_128
-        std::transform(this->expanded, this->expanded + size * size,
-                       this->expanded,
+        std::transform(data, data + size * size,
+                       data,
                        std::bind(std::plus<double>(), std::placeholders::_1, -128));
     #endif
 
-    algo::transformDCT(this->expanded, size * size);
+    algo::transformDCT(data, size * size);
 
-    // Divide every element from this->expanded with an element in m on the same index
-    std::transform(this->expanded, this->expanded + size * size,
-                   m,
-                   this->expanded,
-                   [=](const double& e_, const double& m_){ return std::round(e_ / m_); });
+    // Divide every element from data in zig-zag order with the next element in m
+    for (size_t i = 0; i < size * size; i++) {
+        this->expanded[i] = int16_t(std::round(data[algo::ZigZagLUT<size>[i]] / m[i]));
+    }
 }
 
 /**
  *  @brief  Perform inverse DCT on the Block data.
  *
- *          Multiply with the quant_matrix,
- *          call transformDCTinverse on the data,
+ *          Multiply with the quant_matrix (in zig-zag order) into a double buffer,
+ *          call transformDCTinverseSparse on the data, which picks a faster path
+ *          if only the first few coefficients in zig-zag order are coded,
  *          then add 128 to every value (if enabled) to restore the original DCT components.
+ *
+ *          The result is stored floored, so expand() and expandDifferences()
+ *          give the same pixels as truncating the clamped double values.
  */
 template<size_t size>
 void dc::Block<size>::processIDCTMulQ(const double m[]) {
-    // Multiply every element from this->expanded with an element in m on the same index
-    std::transform(this->expanded, this->expanded + size * size,
-                   m,
+    alignas(dc::BlockPlane<size>::ALIGNMENT) double data[size * size];
+
+    // Multiply every element from this->expanded with an element in m on the same index,
+    // and put it back on its position in the Block
+    for (size_t i = 0; i < size * size; i++) {
+        data[algo::ZigZagLUT<size>[i]] = double(this->expanded[i]) * m[i];
+    }
+
+    algo::transformDCTinverseSparse(data, size * size, algo::ZigZagLUT<size>.data(), this->coded);
+
+    #ifdef SUBTRACT_128
+        std::transform(data, data + size * size,
+                       data,
+                       std::bind(std::plus<double>(), std::placeholders::_1, 128));
+    #endif
+
+    std::transform(data, data + size * size,
                    this->expanded,
-                   std::multiplies<double>());
+                   [=](const double& e_){
+                       return int16_t(std::clamp(std::floor(e_),
+                                                 double(std::numeric_limits<int16_t>::min()),
+                                                 double(std::numeric_limits<int16_t>::max())));
+                   });
+}
+
+/**
+ *  @brief  Perform a reduced inverse DCT on the Block data and write (size/scale)^2 pixels to the view,
+ *          for decoding at a fraction of the original resolution (the scale of the view).
+ *
+ *          Only the lowest (size/scale)^2 frequencies are multiplied with the quant_matrix,
+ *          scaled by 1/scale to keep the orthonormal DCT of the smaller size, and transformed
+ *          with a (size/scale) point iDCT. A single point is only the DC coefficient (the mean),
+ *          two points use the 2x2 butterfly, larger sizes the selected transform backend.
+ *
+ *  @param  m
+ *      The quant_matrix in zig-zag order.
+ */
+template<size_t size>
+void dc::Block<size>::expandScaled(const double m[]) const {
+    const size_t scale = this->view.scale;
+    const size_t n     = size / scale;
+    alignas(dc::BlockPlane<size>::ALIGNMENT) double data[size * size];
 
-    algo::transformDCTinverse(this->expanded, size * size);
+    std::fill_n(data, n * n, 0.0);
+
+    for (size_t i = 0; i < this->coded; i++) {
+        const size_t u = algo::ZigZagLUT<size>[i] % size;   // Column (horizontal frequency)
+        const size_t v = algo::ZigZagLUT<size>[i] / size;   // Row (vertical frequency)
+
+        if (u < n && v < n) {
+            data[v * n + u] = double(this->expanded[i]) * m[i] / double(scale);
+        }
+    }
+
+    if (n == 2u) {
+        const double a = data[0] + data[1], b = data[0] - data[1];
+        const double c = data[2] + data[3], d = data[2] - data[3];
+
+        data[0] = (a + c) / 2.0;
+        data[1] = (b + d) / 2.0;
+        data[2] = (a - c) / 2.0;
+        data[3] = (b - d) / 2.0;
+    } else if (n > 2u) {
+        algo::transformDCTinverse(data, n * n);
+    }
 
     #ifdef SUBTRACT_128
-        std::transform(this->expanded, this->expanded + size * size,
-                       this->expanded,
+        std::transform(data, data + n * n,
+                       data,
                        std::bind(std::plus<double>(), std::placeholders::_1, 128));
     #endif
+
+    uint8_t *row = this->view.row(0);
+
+    for (size_t y = 0; y < n; y++, row += this->view.stride) {
+        for (size_t x = 0; x < n; x++) {
+            row[x] = uint8_t(std::clamp(std::floor(data[y * n + x]), 0.0, 255.0));
+        }
+    }
+}
+
+/**
+ *  @brief  Check whether every pixel in the Block has the same value (min == max).
+ *          Compares 16 pixels at a time with SSE2 if available.
+ */
+template<size_t size>
+bool dc::Block<size>::isUniform(void) const {
+    const uint8_t first = this->view.row(0)[0];
+
+    #ifdef __SSE2__
+        const __m128i ref = _mm_set1_epi8(char(first));
+
+        if constexpr (size >= 16u) {
+            for (size_t y = 0; y < size; y++) {
+                for (size_t x = 0; x < size; x += 16u) {
+                    const __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(this->view.row(y) + x));
+
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi8(row, ref)) != 0xFFFF) {
+                        return false;
+                    }
+                }
+            }
+        } else if constexpr (size == 8u) {
+            for (size_t y = 0; y < size; y += 2u) {
+                const __m128i rows = _mm_unpacklo_epi64(
+                    _mm_loadl_epi64(reinterpret_cast<const __m128i*>(this->view.row(y))),
+                    _mm_loadl_epi64(reinterpret_cast<const __m128i*>(this->view.row(y + 1))));
+
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(rows, ref)) != 0xFFFF) {
+                    return false;
+                }
+            }
+        } else {
+            static_assert(size == 4u, "Uniform check expects a block size of 4, 8 or a multiple of 16");
+            int32_t r[4];
+
+            for (size_t y = 0; y < 4u; y++) {
+                std::memcpy(&r[y], this->view.row(y), 4u);
+            }
+
+            const __m128i rows = _mm_setr_epi32(r[0], r[1], r[2], r[3]);
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(rows, ref)) != 0xFFFF) {
+                return false;
+            }
+        }
+    #else
+        for (size_t y = 0; y < size; y++) {
+            for (size_t x = 0; x < size; x++) {
+                if (this->view.row(y)[x] != first) {
+                    return false;
+                }
+            }
+        }
+    #endif
+
+    return true;
 }
 
+#ifdef __SSE2__
 /**
- *  @brief  Create an RLE sequence from the calculated values according to zig-zag pattern.
- *          For every element, store it in the form: (#zeroes, #bits)(data)
+ *  @brief  Load 16 pixels of a Block: all rows of a 4x4 Block, 2 rows of an 8x8 Block or part of a row.
  *
- *          Print with this->printRLE().
+ *  @param  chunk
+ *      The chunk of 16 pixels, there are (size*size/16) chunks.
  */
 template<size_t size>
-void dc::Block<size>::createRLESequence(void) {
-    if (this->rle_Data != nullptr) {
-        util::deallocVector(this->rle_Data);
+static inline __m128i LoadPixelChunk(const dc::BlockView &view, const size_t chunk) {
+    if constexpr (size >= 16u) {
+        const size_t per_row = size / 16u;
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(view.row(chunk / per_row) + (chunk % per_row) * 16u));
+    } else if constexpr (size == 8u) {
+        return _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(view.row(chunk * 2u))),
+                                  _mm_loadl_epi64(reinterpret_cast<const __m128i*>(view.row(chunk * 2u + 1u))));
+    } else {
+        static_assert(size == 4u, "Pixel chunks expect a block size of 4, 8 or a multiple of 16");
+        int32_t r[4];
+
+        for (size_t y = 0; y < 4u; y++) {
+            std::memcpy(&r[y], view.row(y), 4u);
+        }
+
+        return _mm_setr_epi32(r[0], r[1], r[2], r[3]);
     }
+}
+#endif
 
-    this->rle_Data = util::allocVar<std::vector<algo::RLE_data_t*>>();
+/**
+ *  @brief  Calculate a 64-bit hash of the pixels of the Block, to find repeated Blocks.
+ *          With SSE2, every 16 pixels are mixed into two 64-bit accumulators
+ *          (the 32-bit halves multiplied, like XXH3), else FNV-1a is used.
+ *          Equal hashes do not guarantee equal pixels, see hasSamePixels().
+ */
+template<size_t size>
+uint64_t dc::Block<size>::hashPixels(void) const {
+    uint64_t hash;
 
-    algo::RLE_data_t *info  = util::allocVar<algo::RLE_data_t>();
-    algo::RLE_data_t *entry = nullptr;
+    #ifdef __SSE2__
+        __m128i acc = _mm_set_epi64x(int64_t(0x9E3779B185EBCA87ull), int64_t(0xC2B2AE3D27D4EB4Full));
 
-    // Block info element
-    info->zeroes    = 0;    // Unused
-    info->data_bits = 0;    // Max bits needed for any following element
-    info->data      = 0;    // Amount of elements after this
+        for (size_t c = 0; c < size * size / 16u; c++) {
+            const __m128i data = LoadPixelChunk<size>(this->view, c);
+            const __m128i x    = _mm_xor_si128(data, _mm_set1_epi64x(int64_t(0x165667B19E3779F9ull * (c + 1u))));
+            const __m128i prod = _mm_mul_epu32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+
+            acc = _mm_add_epi64(acc, _mm_add_epi64(prod, _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+
+        hash = lanes[0] ^ (lanes[1] * 0x9E3779B185EBCA87ull);
+    #else
+        hash = 0xCBF29CE484222325ull;
+
+        for (size_t y = 0; y < size; y++) {
+            for (size_t x = 0; x < size; x++) {
+                hash = (hash ^ this->view.row(y)[x]) * 0x100000001B3ull;
+            }
+        }
+    #endif
+
+    // Avalanche, so every input bit affects the low bits used by hash tables
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+/**
+ *  @brief  Check whether the pixels of the Block are equal to the pixels of another view.
+ *          Compares 16 pixels at a time with SSE2 if available.
+ */
+template<size_t size>
+bool dc::Block<size>::hasSamePixels(const dc::BlockView &other) const {
+    #ifdef __SSE2__
+        for (size_t c = 0; c < size * size / 16u; c++) {
+            const __m128i a = LoadPixelChunk<size>(this->view, c);
+            const __m128i b = LoadPixelChunk<size>(other, c);
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) {
+                return false;
+            }
+        }
+    #else
+        for (size_t y = 0; y < size; y++) {
+            if (std::memcmp(this->view.row(y), other.row(y), size) != 0) {
+                return false;
+            }
+        }
+    #endif
+
+    return true;
+}
+
+/**
+ *  @brief  Copy the coefficients and the RLE sequence of another Block,
+ *          instead of transforming pixels that are the same (see hasSamePixels()).
+ */
+template<size_t size>
+void dc::Block<size>::copyCoefficientsFrom(const dc::Block<size> &other) {
+    std::copy_n(other.expanded, size * size, this->expanded);
+
+    if (this->rle_Data != nullptr && other.rle_Data != nullptr) {
+        std::copy_n(other.rle_Data, other.rle_length, this->rle_Data);
+        this->rle_length = other.rle_length;
+    }
+
+    this->coded = other.coded;
+}
+
+/**
+ *  @brief  Fast path for processDCTDivQ() and createRLESequence() on a uniform Block.
+ *
+ *          The DCT of a constant block only has a DC coefficient (size * value),
+ *          so the quantized DC is calculated directly and the RLE sequence
+ *          is created without iterating the zig-zag pattern.
+ *
+ *  @return Returns false (and does nothing) if the Block is not uniform.
+ */
+template<size_t size>
+bool dc::Block<size>::processUniformDivQ(const double m[]) {
+    if (!this->isUniform()) {
+        return false;
+    }
+
+    double value = double(this->view.row(0)[0]);
+
+    #ifdef SUBTRACT_128
+        value -= 128.0;
+    #endif
+
+    std::fill_n(this->expanded, size * size, int16_t(0));
+    this->expanded[0] = int16_t(std::round(double(size) * value / m[0]));
+
+    this->createDCRLESequence();
+
+    return true;
+}
+
+/**
+ *  @brief  Change the quantization of the coefficients without a transform:
+ *          every coefficient is multiplied with its old quantization step and divided by the new one.
+ *          Only the coded coefficients can become non-zero, so the rest is skipped.
+ *
+ *  @param  from
+ *      The quantization matrix the coefficients were divided by, in zig-zag order.
+ *  @param  to
+ *      The new quantization matrix, in zig-zag order.
+ */
+template<size_t size>
+void dc::Block<size>::requantise(const double from[], const double to[]) {
+    const size_t coded = this->coded;
+
+    this->coded = 0u;
+
+    for (size_t i = 0; i < coded; i++) {
+        this->expanded[i] = int16_t(std::round(this->expanded[i] * from[i] / to[i]));
+
+        if (this->expanded[i] != 0) {
+            this->coded = i + 1u;
+        }
+    }
+}
 
-    this->rle_Data->push_back(info);
+/**
+ *  @brief  Copy the coefficients of another Block in a different order, negating some of them.
+ *          Flipping or transposing the pixels of a Block does this to its DCT coefficients,
+ *          so the result is exact (see LosslessTransformer).
+ *
+ *  @param  other
+ *      The Block to copy the coefficients from.
+ *  @param  index
+ *      For every zig-zag position, the zig-zag position in other to copy from.
+ *  @param  negate
+ *      For every zig-zag position, whether the coefficient changes sign.
+ */
+template<size_t size>
+void dc::Block<size>::loadPermuted(const dc::Block<size> &other, const uint16_t index[], const bool negate[]) {
+    this->coded = 0u;
 
-    // Iterate Block data by zig-zag positions
-    for (const algo::Position_t& p : BlockZigZagLUT) {
-        const int16_t data = int16_t(this->expanded[p.y * size + p.x]);
+    for (size_t i = 0; i < size * size; i++) {
+        const int16_t data = other.expanded[index[i]];
 
-        if (entry == nullptr) {
-            entry = util::allocVar<algo::RLE_data_t>();
+        this->expanded[i] = negate[i] ? int16_t(-data) : data;
+
+        if (data != 0) {
+            this->coded = i + 1u;
         }
+    }
+}
+
+/**
+ *  @brief  Create the RLE sequence for a Block with only a DC coefficient,
+ *          the same as createRLESequence() would create.
+ */
+template<size_t size>
+void dc::Block<size>::createDCRLESequence(void) {
+    algo::RLE_data_t &info = this->rle_Data[0];
+    const int16_t data = this->expanded[0];
+
+    info = algo::RLE_data_t { 0, 0, 0 };
+    this->rle_length = 1u;
+
+    if (data != 0) {
+        const uint8_t data_bits = util::bits_needed(data);
+
+        this->rle_Data[this->rle_length++] = algo::RLE_data_t { 0, data_bits, data };
+
+        info.data_bits = std::max(data_bits, util::ffs(1u));
+        info.data      = 1;
+    }
+
+    this->coded = size_t(info.data);
+}
+
+/**
+ *  @brief  Create an RLE sequence from the calculated values according to zig-zag pattern.
+ *          For every element, store it in the form: (#zeroes, #bits)(data)
+ *
+ *          Print with this->printRLE().
+ */
+template<size_t size>
+void dc::Block<size>::createRLESequence(void) {
+    algo::RLE_data_t &info = this->rle_Data[0];
+    algo::RLE_data_t entry { 0, 0, 0 };
+
+    // Block info element
+    info.zeroes    = 0;     // Unused
+    info.data_bits = 0;     // Max bits needed for any following element
+    info.data      = 0;     // Amount of elements after this
+
+    this->rle_length = 1u;
+
+    // Block data is already in zig-zag order
+    for (size_t i = 0; i < size * size; i++) {
+        const int16_t data = this->expanded[i];
 
         if (data == 0) {
-            entry->zeroes++;
+            entry.zeroes++;
         } else {
-            entry->data_bits = util::bits_needed(data);  // Returns minimal bits needed to represent data as signed.
-            entry->data      = data;
+            entry.data_bits = util::bits_needed(data);  // Returns minimal bits needed to represent data as signed.
+            entry.data      = data;
 
             // Gather block info
-            info->data_bits = std::max(info->data_bits, entry->data_bits);  // Save max bits needed
-            info->data     += 1 + entry->zeroes;                            // Add total data elements
+            info.data_bits = std::max(info.data_bits, entry.data_bits);  // Save max bits needed
+            info.data     += 1 + entry.zeroes;                           // Add total data elements
 
-            this->rle_Data->push_back(entry);
-            entry = nullptr;
+            this->rle_Data[this->rle_length++] = entry;
+            entry = algo::RLE_data_t { 0, 0, 0 };
         }
     }
 
-    if (entry != nullptr) {
-        delete entry;
-    }
-
     // Increase needed data bits if the data length does not fit in the current amount of bits
-    info->data_bits = std::max(info->data_bits, util::ffs(uint32_t(info->data)));
+    info.data_bits = std::max(info.data_bits, util::ffs(uint32_t(info.data)));
+
+    this->coded = size_t(info.data);
 }
 
 /**
@@ -239,14 +660,14 @@ void dc::Block<size>::createRLESequence(void) {
  *  @return
  */
 template<size_t size>
-size_t dc::Block<size>::relativeAbsDifferenceWith(const dc::Block<dc::MacroBlockSize>& other) {
+size_t dc::Block<size>::relativeAbsDifferenceWith(const dc::BlockView& other) const {
+    const uint8_t *this_y  = this->view.row(0);
+    const uint8_t *other_y = other.row(0);
     size_t diff = 0ull;
 
-    for (size_t y = 0; y < size; y++) {
-        const uint8_t* other_y = other.getRow(y);
-
+    for (size_t y = 0; y < size; y++, this_y += this->view.stride, other_y += other.stride) {
         for (size_t x = 0; x < size; x++) {
-            diff += size_t(std::abs(int16_t(this->matrix[y][x]) - int16_t(other_y[x])));
+            diff += size_t(std::abs(int16_t(this_y[x]) - int16_t(other_y[x])));
         }
     }
 
@@ -254,12 +675,13 @@ size_t dc::Block<size>::relativeAbsDifferenceWith(const dc::Block<dc::MacroBlock
 }
 
 template<size_t size>
-void dc::Block<size>::expandDifferenceWith(const dc::Block<dc::MacroBlockSize>& other) {
-    for (size_t y = 0; y < size; y++) {
-        const uint8_t* other_y = other.getRow(y);
+void dc::Block<size>::expandDifferenceWith(const dc::BlockView& other) {
+    const uint8_t *this_y  = this->view.row(0);
+    const uint8_t *other_y = other.row(0);
 
+    for (size_t y = 0; y < size; y++, this_y += this->view.stride, other_y += other.stride) {
         for (size_t x = 0; x < size; x++) {
-            this->expanded[y * size + x] = double(this->matrix[y][x]) - double(other_y[x]);
+            this->expanded[y * size + x] = int16_t(this_y[x]) - int16_t(other_y[x]);
         }
     }
 }
@@ -270,7 +692,7 @@ void dc::Block<size>::processFindMotionOffset(dc::Frame * const ref_frame) {
     // mvec_this has block pixel coords
 
     algo::MER_level_t *lowest_point = &BlockMERLUT;
-    dc::MacroBlock    *lowest_block = ref_frame->getBlockAtCoord(lowest_point->x0, lowest_point->y0);
+    dc::BlockView      lowest_block = ref_frame->getViewAtCoord(lowest_point->x0, lowest_point->y0);
     size_t             lowest_diff  = std::numeric_limits<size_t>::max();
 
 
@@ -281,47 +703,39 @@ void dc::Block<size>::processFindMotionOffset(dc::Frame * const ref_frame) {
         // Best point found in lowest_point->points
         algo::MER_level_t *new_lowest_point = nullptr;
         size_t             new_lowest_diff  = lowest_diff;
-        dc::MacroBlock    *new_lowest_block = nullptr;
+        dc::BlockView      new_lowest_block = lowest_block;
 
         // For each point offset in pattern
         for (size_t p = 0; p < algo::MER_PATTERN_SIZE; p++) {
             algo::MER_level_t *current_point = &lowest_point->points[p];
 
             // Block pixel (x, y) = current block pixel + offset
-            const int16_t pixel_x = current_point->x0 + this->mvec_this.x0;
-            const int16_t pixel_y = current_point->y0 + this->mvec_this.y0;
+            const int32_t pixel_x = current_point->x0 + this->mvec_this.x0;
+            const int32_t pixel_y = current_point->y0 + this->mvec_this.y0;
 
             // Get MacroBlock at that offset
-            dc::MacroBlock *current_block = ref_frame->getBlockAtCoord(pixel_x, pixel_y);
+            const dc::BlockView current_block = ref_frame->getViewAtCoord(pixel_x, pixel_y);
 
-            if (p > 0 && !this->isDifferentBlock(*current_block)) {
+            if (p > 0 && !this->isDifferentBlock(current_block)) {
                 // If (clamped) coord is the same as this, skip
-                util::deallocVar(current_block);
                 continue;
             }
 
             // Calculate diff with offset block
-            const size_t current_diff = this->relativeAbsDifferenceWith(*current_block);
+            const size_t current_diff = this->relativeAbsDifferenceWith(current_block);
 
             if (current_diff <= new_lowest_diff) {
                 // Block at offset appears better than previously found Block
-                util::deallocVar(new_lowest_block);
-
                 new_lowest_point = current_point;
                 new_lowest_diff  = current_diff;
                 new_lowest_block = current_block;
-            } else {
-                util::deallocVar(current_block);
             }
         }
 
         if (new_lowest_point == nullptr) {
             // No other point had a lower diff than current middle => early exit
-            util::deallocVar(new_lowest_block);
             break;
         } else {
-            util::deallocVar(lowest_block);
-
             lowest_point = new_lowest_point;
             lowest_block = new_lowest_block;
             lowest_diff  = new_lowest_diff;
@@ -329,13 +743,12 @@ void dc::Block<size>::processFindMotionOffset(dc::Frame * const ref_frame) {
     }
 
     // Relative offset only, this->mvec_this should be added to this value by the decoder
-    // to get the pixel coordinate back (now in lowest_block->getCoord()).
+    // to get the pixel coordinate back (now in lowest_block.x and lowest_block.y).
     this->mvec.x0 = lowest_point->x0;
     this->mvec.y0 = lowest_point->y0;
 
     // Expand diff with lowest_block to this->expanded
-    this->expandDifferenceWith(*lowest_block);
-    util::deallocVar(lowest_block);
+    this->expandDifferenceWith(lowest_block);
 }
 
 /**
@@ -344,13 +757,56 @@ void dc::Block<size>::processFindMotionOffset(dc::Frame * const ref_frame) {
  */
 template<size_t size>
 size_t dc::Block<size>::streamSize(void) const {
-    if (this->rle_Data == nullptr) {
+    if (this->rle_length == 0u) {
         return dc::Block<size>::SIZE_LEN_BITS   // 4 bits for bit length
              + (size * size * 16u);         // Upper estimate for needed bits
     } else {
         // Exact prediction if RLE sequence is known
-        return dc::Block<size>::SIZE_LEN_BITS + (size * size * this->rle_Data->front()->data_bits);
+        return dc::Block<size>::SIZE_LEN_BITS + (size * size * this->rle_Data[0].data_bits);
+    }
+}
+
+/**
+ *  @brief  Get the exact amount of bits streamEncoded() will write for this Block.
+ *          Only valid after the RLE sequence was created.
+ *
+ *  @param  use_rle
+ *      Whether to use RLE.
+ *  @return Returns the length for the Block in bits.
+ */
+template<size_t size>
+size_t dc::Block<size>::streamLength(bool use_rle) const {
+    if (this->rle_length == 0u) {
+        return 0u;
+    }
+
+    const algo::RLE_data_t& info = this->rle_Data[0];
+    const algo::RLE_data_t& last = this->rle_Data[this->rle_length - 1u];
+    const size_t bit_len = info.data_bits;
+         int32_t length  = info.data;
+          size_t elements = 0u;
+
+    if (use_rle) {
+        if ((length == size * size) && last.zeroes) {
+            length -= last.zeroes + 1;
+        }
+
+        elements++;     // Amount of data elements
+    } else {
+        length = size * size;
+    }
+
+    // Count the same elements as streamEncoded() writes
+    for (size_t e = 1u; e < this->rle_length && length > 0; e++, length--) {
+        elements += this->rle_Data[e].zeroes + 1u;
+        length   -= this->rle_Data[e].zeroes;
+    }
+
+    if (length > 0) {
+        elements += size_t(length);
     }
+
+    return dc::Block<size>::SIZE_LEN_BITS + elements * bit_len;
 }
 
 /**
@@ -370,13 +826,14 @@ size_t dc::Block<size>::streamSize(void) const {
  */
 template<size_t size>
 void dc::Block<size>::streamEncoded(util::BitStreamWriter& writer, bool use_rle) const {
-    if (this->rle_Data == nullptr) {
+    if (this->rle_length == 0u) {
         return;
     }
 
-    const algo::RLE_data_t* info = this->rle_Data->front();
-    const uint32_t bit_len = info->data_bits;
-           int32_t length  = info->data;
+    const algo::RLE_data_t& info = this->rle_Data[0];
+    const algo::RLE_data_t& last = this->rle_Data[this->rle_length - 1u];
+    const uint32_t bit_len = info.data_bits;
+           int32_t length  = info.data;
 
     writer.put(Block::SIZE_LEN_BITS, bit_len);
 
@@ -385,8 +842,8 @@ void dc::Block<size>::streamEncoded(util::BitStreamWriter& writer, bool use_rle)
     // Else, use the entire Block size as length and don't add the length to the
     // stream, since it will be (size*size) for every Block.
     if (use_rle) {
-        if ((length == size * size) && this->rle_Data->back()->zeroes) {
-            length -= this->rle_Data->back()->zeroes + 1;  // Loose last zeroes and data
+        if ((length == size * size) && last.zeroes) {
+            length -= last.zeroes + 1;  // Loose last zeroes and data
         }
 
         // Write amount of data elements written
@@ -398,12 +855,12 @@ void dc::Block<size>::streamEncoded(util::BitStreamWriter& writer, bool use_rle)
 
     // Iterate over the RLE sequence and add zeroes and the data element, according to
     // the maximum required length to write.
-    for (auto start = this->rle_Data->begin() + 1; start != this->rle_Data->end() && length > 0; start++, length--) {
-        for (size_t i = (*start)->zeroes; i--;) {
+    for (size_t e = 1u; e < this->rle_length && length > 0; e++, length--) {
+        for (size_t i = this->rle_Data[e].zeroes; i--;) {
             writer.put(bit_len, 0u);
             length--;
         }
-        writer.put(bit_len, uint32_t((*start)->data));
+        writer.put(bit_len, uint32_t(this->rle_Data[e].data));
     }
 
     // Append extra zeroes if length is not reached (when not using rle)
@@ -431,7 +888,7 @@ void dc::Block<size>::streamMVec(util::BitStreamWriter& writer) const {
  *          2. If using RLE, read the amount of data element that will follow,
  *             else, read (size*size) data elements
  *          3. Read every data element with a maximum bit_len and
- *             store it in the internal double array by the zig-zag positions.
+ *             store it in the internal coefficient array by the zig-zag positions.
  *             If the amount of data elements was smaller than the size of the array,
  *             the other elements will stay at 0.0 as expected.
  *
@@ -457,17 +914,107 @@ void dc::Block<size>::loadFromStream(util::BitStreamReader &reader, bool use_rle
         reader.set_position(start);
     #endif
 
+    this->coded = 0;
+
     for (size_t i = 0; i < length; i++) {
-        const algo::Position_t pos = BlockZigZagLUT[i];
         // Shift data exactly bit_len bits to the left, and shift back to the right
         // to make it properly signed again.
-        this->expanded[pos.y * size + pos.x] = util::shift_signed<int16_t>(reader.get(bit_len), bit_len);
+        const int16_t data = util::shift_signed<int16_t>(reader.get(bit_len), bit_len);
+
+        this->expanded[i] = data;
+
+        if (data != 0) {
+            this->coded = i + 1;
+        }
     }
 
     // Fill values that were not read with 0
-    for (size_t i = length; i < size * size; i++) {
-        const algo::Position_t pos = BlockZigZagLUT[i];
-        this->expanded[pos.y * size + pos.x] = 0;
+    std::fill(this->expanded + length, this->expanded + size * size, int16_t(0));
+}
+
+/**
+ *  @brief  Move the reader past one Block written by streamEncoded(), without loading it.
+ *          Only the bit length (and the amount of elements if using RLE) is read.
+ *
+ *  @param  reader
+ *  @param  use_rle
+ */
+template<size_t size>
+void dc::Block<size>::SkipInStream(util::BitStreamReader &reader, bool use_rle) {
+    const size_t bit_len = reader.get(Block::SIZE_LEN_BITS);
+    const size_t length  = (use_rle ? (reader.get(bit_len)) : (size * size));
+
+    reader.set_position(reader.get_position() + length * bit_len);
+}
+
+/**
+ *  @brief  Stream a band of the zig-zag ordered coefficients to the given BitStreamWriter,
+ *          for the progressive layout (see ImageProcessor::PROGRESSIVE_BANDS).
+ *
+ *          1. Write the required bit length for the elements of the band (0 if they are all zero)
+ *          2. Write every element of the band with that bit length
+ *
+ *  @param  writer
+ *      The BitStreamWriter to stream the encoded data to.
+ *  @param  begin
+ *      The first zig-zag position of the band.
+ *  @param  end
+ *      The zig-zag position after the band.
+ */
+template<size_t size>
+void dc::Block<size>::streamBand(util::BitStreamWriter& writer, const size_t begin, const size_t end) const {
+    uint8_t bit_len = 0u;
+
+    for (size_t i = begin; i < end; i++) {
+        if (this->expanded[i] != 0) {
+            bit_len = std::max(bit_len, util::bits_needed(this->expanded[i]));
+        }
+    }
+
+    writer.put(Block::SIZE_LEN_BITS, bit_len);
+
+    if (bit_len == 0u) {
+        return;
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        writer.put(bit_len, uint32_t(this->expanded[i]));
+    }
+}
+
+/**
+ *  @brief  Load a band of coefficients from the stream, see streamBand().
+ *          Loading the first band clears every coefficient, so the bands that are never loaded
+ *          (e.g. in a truncated stream) stay zero.
+ *
+ *  @param  reader
+ *      The BitStreamReader to read from.
+ *  @param  begin
+ *      The first zig-zag position of the band.
+ *  @param  end
+ *      The zig-zag position after the band.
+ */
+template<size_t size>
+void dc::Block<size>::loadBand(util::BitStreamReader &reader, const size_t begin, const size_t end) {
+    if (begin == 0u) {
+        std::fill(this->expanded, this->expanded + size * size, int16_t(0));
+        this->coded = 0;
+    }
+
+    const size_t bit_len = reader.get(Block::SIZE_LEN_BITS);
+
+    if (bit_len == 0u) {
+        return;
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        const int16_t data = util::shift_signed<int16_t>(reader.get(bit_len), bit_len);
+
+        this->expanded[i] = data;
+
+        if (data != 0) {
+            this->coded = std::max(this->coded, i + 1);
+        }
     }
 }
 
@@ -486,13 +1033,8 @@ void dc::Block<dc::MacroBlockSize>::loadFromReferenceStream(util::BitStreamReade
 
     const algo::MER_level_t mvec_coord = this->getCoordAfterMotion();
 
-    // Get Macroblock in reference frame at location of motion offset
-    dc::MacroBlock *ref_block = ref_frame->getBlockAtCoord(mvec_coord.x0, mvec_coord.y0);
-
-    // Copy values from reference block to this
-    ref_block->copyBlockMatrixTo(*this);
-
-    util::deallocVar(ref_block);
+    // Copy values from the Macroblock in reference frame at location of motion offset to this
+    this->copyMatrixFrom(ref_frame->getViewAtCoord(mvec_coord.x0, mvec_coord.y0));
 }
 
 //////////////////////////////////////////////////////////////////
@@ -500,7 +1042,7 @@ void dc::Block<dc::MacroBlockSize>::loadFromReferenceStream(util::BitStreamReade
 //////////////////////////////////////////////////////////////////
 
 /**
- *  @brief  Print the internal double matrix in a zig-zag pattern.
+ *  @brief  Print the internal coefficient matrix in a zig-zag pattern.
  *          (As seen from the wiki)
  *
  *  Example matrix:
@@ -525,8 +1067,8 @@ void dc::Block<size>::printZigzag(void) const {
 
     util::Logger::WriteLn("Zigzag:");
 
-    for (const algo::Position_t& p : BlockZigZagLUT) {
-        util::Logger::Write(std::string_format("%3d ", int16_t(this->expanded[p.y * size + p.x])), false);
+    for (size_t i = 0; i < size * size; i++) {
+        util::Logger::Write(std::string_format("%3d ", this->expanded[i]), false);
 
         if (++current >= line_length) {
             current = 0;
@@ -562,21 +1104,23 @@ void dc::Block<size>::printRLE(void) const {
     bool info = true;
 
     util::Logger::WriteLn("RLE:");
-    if (this->rle_Data == nullptr) {
+    if (this->rle_length == 0u) {
         return;
     }
 
-    for (const algo::RLE_data_t* e : *this->rle_Data) {
+    for (size_t i = 0; i < this->rle_length; i++) {
+        const algo::RLE_data_t& e = this->rle_Data[i];
+
         if (info) {
             util::Logger::WriteLn(std::string_format("Bits needed: %d\n"
                                                      "Data length: %d\n"
                                                      "Sequence   : (#zeroes, #bits)(data)",
-                                                     e->data_bits, e->data),
+                                                     e.data_bits, e.data),
                                   false);
             info = false;
         } else {
             util::Logger::Write(std::string_format("(%d,%d)(%02X), ",
-                                                   e->zeroes, e->data_bits, uint8_t(e->data)),
+                                                   e.zeroes, e.data_bits, uint8_t(e.data)),
                                 false);
         }
     }
@@ -586,7 +1130,8 @@ void dc::Block<size>::printRLE(void) const {
 }
 
 /**
- *  @brief  Print the internal double matrix data as an int16.
+ *  @brief  Print the internal data as stored:
+ *          pixels or prediction errors in rows, or coefficients in zig-zag order.
  */
 template<size_t size>
 void dc::Block<size>::printExpanded(void) const {
@@ -605,25 +1150,12 @@ template<size_t size>
 void dc::Block<size>::printMatrix(void) const {
     for (size_t y = 0; y < size; y++) {
         for (size_t x = 0; x < size; x++) {
-            util::Logger::Write(std::string_format("%3d ", this->matrix[y][x]), false);
+            util::Logger::Write(std::string_format("%3d ", this->view.row(y)[x]), false);
         }
         util::Logger::WriteLn("", false);
     }
 }
 
-/**
- *  @brief  Create the zig-zag positions LUT.
- */
-template<size_t size>
-void dc::Block<size>::CreateZigZagLUT(void) {
-    // TODO Zigzag for Macroblock?
-
-    if (BlockZigZagLUT.size() == 0) {
-        util::Logger::WriteLn(std::string_format("[Block] Caching zig-zag pattern for blocksize %d...", dc::BlockSize));
-        algo::createZigzagLUT(BlockZigZagLUT, size);
-    }
-}
-
 template<size_t size>
 void dc::Block<size>::CreateMERLUT(const uint16_t& merange) {
     if (BlockMERLUT.points == nullptr) {
@@ -4,17 +4,75 @@
 #include "BitStream.hpp"
 #include "algo.hpp"
 #include <vector>
+#include <type_traits>
 
 namespace dc {
     /**
      *  @brief  The size (width and height) for a Block inside an image.
-     *          This is used everywhere and can be changed if needed.
+     *          BlockSize is the default, the actual size used for an image
+     *          is determined at runtime by the size of the quantization matrix.
      */
     static constexpr uint16_t BlockSize      =  4u;
     static constexpr uint16_t MacroBlockSize = 16u;
 
+    /**
+     *  @brief  Block sizes with a precompiled Block<size> instantiation.
+     */
+    static constexpr uint16_t MinBlockSize =  4u;
+    static constexpr uint16_t MaxBlockSize = 16u;
+
+    /**
+     *  @brief  Check whether a Block<size> instantiation exists for the given runtime size.
+     */
+    static constexpr inline bool isSupportedBlockSize(const size_t block_size) {
+        return block_size == 4u || block_size == 8u || block_size == 16u;
+    }
+
+    /**
+     *  @brief  Call func with an std::integral_constant for the given runtime block size,
+     *          so it can select the matching Block<size> instantiation at compile time.
+     *
+     *  @param  block_size
+     *      The runtime block size, see isSupportedBlockSize().
+     *  @param  func
+     *      A generic lambda taking an `auto` parameter, use `decltype(param)::value`
+     *      as the template argument.
+     *  @return Returns the result of func, or a value-initialised result
+     *          (e.g. false) if the block size is not supported.
+     */
+    template<class F>
+    inline auto dispatchBlockSize(const size_t block_size, F&& func)
+        -> decltype(func(std::integral_constant<size_t, dc::BlockSize>()))
+    {
+        switch (block_size) {
+            case  4u: return func(std::integral_constant<size_t,  4u>());
+            case  8u: return func(std::integral_constant<size_t,  8u>());
+            case 16u: return func(std::integral_constant<size_t, 16u>());
+            default : return decltype(func(std::integral_constant<size_t, dc::BlockSize>())){};
+        }
+    }
+
     class Frame;
 
+    /**
+     *  @brief  A non-owning view of a square Block of pixels inside an image plane.
+     *          Views are trivially copyable and free to create, row r of the Block
+     *          starts at base + (y + r) * stride + x.
+     */
+    struct BlockView {
+        uint8_t *base;      ///< Start of the image plane.
+        size_t   stride;    ///< Distance in bytes between the starts of two rows (the image width).
+        size_t   x;         ///< Pixel column of the top-left corner.
+        size_t   y;         ///< Pixel row of the top-left corner.
+        size_t   scale = 1u;    ///< The plane is this factor smaller than the image, the view covers (size/scale)^2 pixels.
+
+        inline uint8_t* row(const size_t r) const {
+            return this->base + (this->y + r) * this->stride + this->x;
+        }
+    };
+
+    static_assert(std::is_trivially_copyable_v<dc::BlockView>, "A BlockView should be trivially copyable");
+
     /**
      *  @brief  The Block class
      *          Represents a block, linked to the reader/writer stream,
@@ -26,15 +84,22 @@ namespace dc {
     template<size_t size = dc::BlockSize>
     class Block {
         private:
-            uint8_t *matrix[size];
-            double   expanded[size * size];
-            std::vector<algo::RLE_data_t*> *rle_Data;
+            dc::BlockView view;
+            int16_t *expanded;  ///< (size*size) pixel values (row-major) or quantised coefficients (zig-zag order), owned by a BlockPlane (nullptr for a reference MacroBlock).
+            algo::RLE_data_t *rle_Data;     ///< RLE_CAPACITY elements, owned by a BlockPlane: info element, then every data element.
+            size_t   rle_length;    ///< Amount of used elements in rle_Data, 0 if no sequence was created.
+            size_t   coded;     ///< Amount of coefficients in zig-zag order up to the last non-zero one.
+
+            void createDCRLESequence(void);
 
             algo::MER_level_t mvec_this;
             algo::MER_level_t mvec;
         public:
-            Block(uint8_t *row_offset_list[]);
-            Block(uint8_t *row_offset_list[], int16_t x, int16_t y);
+            Block(const dc::BlockView &view, int16_t *coefficients, algo::RLE_data_t *rle);
+            Block(const dc::BlockView &view, int16_t *coefficients);
+            Block(dc::Block<size>&& other) noexcept;
+            Block(const dc::Block<size>&) = delete;
+            dc::Block<size>& operator=(const dc::Block<size>&) = delete;
             ~Block(void);
 
             void expand(void) const;
@@ -43,22 +108,32 @@ namespace dc {
             // Microblocks
             void processDCTDivQ(const double m[]);
             void processIDCTMulQ(const double m[]);
+            void expandScaled(const double m[]) const;
+            bool processUniformDivQ(const double m[]);
+            void requantise(const double from[], const double to[]);
+            void loadPermuted(const dc::Block<size>&, const uint16_t index[], const bool negate[]);
+            bool isUniform(void) const;
+            uint64_t hashPixels(void) const;
+            bool hasSamePixels(const dc::BlockView&) const;
+            void copyCoefficientsFrom(const dc::Block<size>&);
 
             void createRLESequence(void);
 
-            // Macroblocks
-            void updateRows(uint8_t *row_offset_list[]);
-
             inline uint8_t* getRow(size_t row) const {
-                return this->matrix[row];
+                return this->view.row(row);
+            }
+
+            inline const dc::BlockView& getView(void) const {
+                return this->view;
             }
 
-            inline double* getExpandedRow(size_t row) {
+            inline int16_t* getExpandedRow(size_t row) {
                 return &this->expanded[row * size];
             }
 
-            size_t relativeAbsDifferenceWith(const dc::Block<dc::MacroBlockSize>&);
-            void expandDifferenceWith(const dc::Block<dc::MacroBlockSize>&);
+            // Macroblocks
+            size_t relativeAbsDifferenceWith(const dc::BlockView&) const;
+            void expandDifferenceWith(const dc::BlockView&);
             void processFindMotionOffset(dc::Frame * const ref_frame);
 
             inline algo::MER_level_t getCoord(void) const {
@@ -68,13 +143,13 @@ namespace dc {
             inline algo::MER_level_t getCoordAfterMotion(void) const {
                 return algo::MER_level_t {
                     0,
-                    static_cast<int16_t>(this->mvec_this.x0 + this->mvec.x0),
-                    static_cast<int16_t>(this->mvec_this.y0 + this->mvec.y0),
+                    this->mvec_this.x0 + this->mvec.x0,
+                    this->mvec_this.y0 + this->mvec.y0,
                     nullptr
                 };
             }
 
-            inline bool isDifferentCoord(const int16_t& x, const int16_t& y) const {
+            inline bool isDifferentCoord(const int32_t& x, const int32_t& y) const {
                 return this->mvec_this.x0 != x
                     || this->mvec_this.y0 != y;
             }
@@ -83,34 +158,108 @@ namespace dc {
                 return this->isDifferentCoord(other.x0, other.y0);
             }
 
-            inline bool isDifferentBlock(const dc::Block<dc::MacroBlockSize>& other) const  {
-                return this->isDifferentCoord(other.getCoord());
+            inline bool isDifferentBlock(const dc::BlockView& other) const  {
+                return this->isDifferentCoord(int32_t(other.x), int32_t(other.y));
             }
 
-            void copyBlockMatrixTo(dc::Block<size>&) const;
+            void copyMatrixFrom(const dc::BlockView&);
             void loadFromReferenceStream(util::BitStreamReader&, dc::Frame * const);
 
 
             size_t streamSize(void) const;
+            size_t streamLength(bool) const;
             void streamEncoded(util::BitStreamWriter&, bool) const;
             void streamMVec(util::BitStreamWriter&) const;
 
             void loadFromStream(util::BitStreamReader&, bool);
 
+            void streamBand(util::BitStreamWriter&, const size_t, const size_t) const;
+            void loadBand(util::BitStreamReader&, const size_t, const size_t);
+
             void printZigzag(void) const;
             void printRLE(void) const;
             void printExpanded(void) const;
             void printMatrix(void) const;           
 
-            static void CreateZigZagLUT(void);
             static void CreateMERLUT(const uint16_t &merange);
             static void DestroyMERLUT(void);
+            static void SkipInStream(util::BitStreamReader&, bool);
 
             static constexpr size_t SIZE_LEN_BITS = 4;  ///< The amount of bits to use to represent the bit length of values inside the Block.
+            static constexpr size_t RLE_CAPACITY  = size * size + 1u;  ///< Maximum RLE sequence length: info element and every coefficient.
+            static constexpr size_t MAX_STREAM_BITS = SIZE_LEN_BITS + 16u + size * size * 16u;  ///< Upper bound for streamEncoded() in bits (bit length, RLE length and every value).
+            static constexpr size_t MAX_BAND_BITS   = SIZE_LEN_BITS + size * size * 16u;  ///< Upper bound for streamBand() in bits, for every band together add SIZE_LEN_BITS per band.
+    };
+
+    extern template class dc::Block< 4u>;
+    extern template class dc::Block< 8u>;
+    extern template class dc::Block<16u>;
+
+    /**
+     *  @brief  The BlockPlane class
+     *          Holds the Blocks of an image (or frame) for one Block size.
+     *          The coefficients of every Block are stored in one contiguous, 64-byte aligned
+     *          array indexed by Block id, as are the fixed capacity RLE sequences.
+     *          The Blocks themselves are lightweight handles stored contiguously in the
+     *          same order, so setup is a single allocation per array and the transform
+     *          and RLE loops stream through memory linearly without touching the heap.
+     *
+     * @tparam  bsize
+     *          The Block size.
+     */
+    template<size_t bsize>
+    class BlockPlane {
+        private:
+            size_t  capacity;
+            int16_t *coefficients;                  ///< (capacity * bsize * bsize) coefficients.
+            algo::RLE_data_t *rle;                  ///< (capacity * Block<bsize>::RLE_CAPACITY) RLE elements.
+            std::vector<dc::Block<bsize>> blocks;
+
+        public:
+            BlockPlane(const size_t capacity);
+            BlockPlane(const dc::BlockPlane<bsize>&) = delete;
+            dc::BlockPlane<bsize>& operator=(const dc::BlockPlane<bsize>&) = delete;
+            ~BlockPlane(void);
+
+            dc::Block<bsize>& add(const dc::BlockView &view);
+            dc::Block<bsize>& addMacroBlock(const dc::BlockView &view);
+
+            inline size_t size(void) const {
+                return this->blocks.size();
+            }
+
+            /**
+             *  @brief  Remove every Block, the coefficients and RLE storage are reused by the next ones.
+             */
+            inline void clear(void) {
+                this->blocks.clear();
+            }
+
+            inline dc::Block<bsize>& operator[](const size_t id) {
+                return this->blocks[id];
+            }
+
+            inline const dc::Block<bsize>& operator[](const size_t id) const {
+                return this->blocks[id];
+            }
+
+            inline int16_t* getCoefficients(const size_t id) const {
+                return &this->coefficients[id * bsize * bsize];
+            }
+
+            inline algo::RLE_data_t* getRLE(const size_t id) const {
+                return &this->rle[id * dc::Block<bsize>::RLE_CAPACITY];
+            }
+
+            inline auto begin(void) { return this->blocks.begin(); }
+            inline auto end(void)   { return this->blocks.end();   }
+
+            static constexpr size_t ALIGNMENT = util::PLANE_ALIGNMENT;   ///< Alignment of the coefficient array in bytes (a plane, see util::allocPlane()).
     };
 
-    extern template class dc::Block<dc::BlockSize>;
-    extern template class dc::Block<dc::MacroBlockSize>;
+    extern template class dc::BlockPlane< 4u>;
+    extern template class dc::BlockPlane< 8u>;
+    extern template class dc::BlockPlane<16u>;
 
     using MicroBlock = dc::Block<dc::BlockSize>;
     using MacroBlock = dc::Block<dc::MacroBlockSize>;
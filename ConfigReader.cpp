@@ -37,6 +37,30 @@ const std::string dc::SettingToKey(dc::VideoSetting s) {
             : keys[idx - off];
 }
 
+const std::string dc::SettingToKey(dc::ExtraSetting s) {
+    static const std::string keys[] = {
+        "dctbackend", "adaptive", "blockindex", "strip",
+        "tile"      , "region"  , "progressive", "scale"     ,
+        "pyramid"   , "level"   , "transcode", "orient"    ,
+        "crop"      , "dedup"   , "incremental", "sample"
+    };
+
+    return keys[util::to_underlying(s)];
+}
+
+/**
+ *  @brief  Count the optional settings present in the given key-value map.
+ */
+static size_t CountExtraSettings(const std::map<std::string, std::string> &keyValues) {
+    size_t count = 0;
+
+    for (size_t s = 0; s < util::to_underlying(dc::ExtraSetting::AMOUNT); s++) {
+        count += keyValues.count(dc::SettingToKey(dc::ExtraSetting(s)));
+    }
+
+    return count;
+}
+
 /**
  * @brief ReadInputLine
  * @param fi
@@ -164,6 +188,12 @@ const std::string dc::ConfigReader::getValue(const VideoSetting &key) const {
     return it == this->m_keyValues.end() ? "" : it->second;
 }
 
+const std::string dc::ConfigReader::getValue(const ExtraSetting &key) const {
+    auto it = this->m_keyValues.find(dc::SettingToKey(key));
+
+    return it == this->m_keyValues.end() ? "" : it->second;
+}
+
 const std::string dc::ConfigReader::toString(void) const {
     std::ostringstream oss;
 
@@ -185,7 +215,7 @@ std::string dc::ConfigReader::getErrorDescription(void) const {
 bool dc::ConfigReader::verifyForImage(void) {
     const size_t amount = util::to_underlying(dc::ImageSetting::AMOUNT);
 
-    if (this->m_keyValues.size() != amount) {
+    if (this->m_keyValues.size() - CountExtraSettings(this->m_keyValues) != amount) {
         this->m_errStr = std::string("Too many or too few settings in file for image en/decoder!");
         return false;
     }
@@ -38,6 +38,29 @@ namespace dc {
         AMOUNT
     };
 
+    /**
+     *  @brief  Optional settings, accepted in image and video config files.
+     */
+    enum class ExtraSetting : uint8_t {
+        dctbackend = 0,
+        adaptive,
+        blockindex,
+        strip,
+        tile,
+        region,
+        progressive,
+        scale,
+        pyramid,
+        level,
+        transcode,
+        orient,
+        crop,
+        dedup,
+        incremental,
+        sample,
+        AMOUNT
+    };
+
     static constexpr size_t EXPECTED_VideoEncoderSettings = 8;
     static const VideoSetting VideoEncoderSettings[] = {
         VideoSetting::rawfile, VideoSetting::encfile,
@@ -54,6 +77,7 @@ namespace dc {
 
     const std::string SettingToKey(ImageSetting s);
     const std::string SettingToKey(VideoSetting s);
+    const std::string SettingToKey(ExtraSetting s);
 
     /**
      *  @brief
@@ -74,6 +98,7 @@ namespace dc {
             bool getKeyValue(const VideoSetting &key, std::string &value);
             const std::string getValue(const ImageSetting &key) const;
             const std::string getValue(const VideoSetting &key) const;
+            const std::string getValue(const ExtraSetting &key) const;
             const std::string toString(void) const;
             void clear(void);
             bool verifyForImage(void);
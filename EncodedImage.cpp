@@ -0,0 +1,291 @@
+#include "EncodedImage.hpp"
+#include "main.hpp"
+#include "Logger.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+
+/**
+ *  @brief  An EncodedImage writes no file.
+ */
+static const std::string NO_DESTINATION("");
+
+/**
+ *  @brief  Default ctor, reads the settings header of the encoded image.
+ *
+ *  @param  source_file
+ *      Path to an encoded image file.
+ *  @param  cache_blocks
+ *      The maximum amount of decoded Blocks to keep (at least 1).
+ */
+dc::EncodedImage::EncodedImage(const std::string &source_file, const size_t cache_blocks)
+    : ImageProcessor(source_file, NO_DESTINATION)
+    , cache_capacity(std::max<size_t>(cache_blocks, 1u))
+    , decoded_blocks(0u)
+{
+    this->createIndex();
+}
+
+/**
+ *  @brief  Ctor for an encoded image in memory (e.g. a level of a pyramid).
+ *
+ *  @param  data
+ *      Pointer to the first byte of the encoded stream, it is not owned and must outlive the handle.
+ *  @param  length
+ *      The length of the encoded stream in bytes.
+ *
+ *  See the default ctor for the other parameters.
+ */
+dc::EncodedImage::EncodedImage(uint8_t * const data, const size_t length, const size_t cache_blocks)
+    : ImageProcessor(data, length, NO_DESTINATION)
+    , cache_capacity(std::max<size_t>(cache_blocks, 1u))
+    , decoded_blocks(0u)
+{
+    this->createIndex();
+}
+
+/**
+ *  @brief  Default dtor
+ */
+dc::EncodedImage::~EncodedImage(void) {
+    // Empty
+}
+
+/**
+ *  @brief  Create the lazy block index: only the offsets of the block or tile index are known,
+ *          the offset of every other Block is found when it is first needed (see findSource()).
+ */
+void dc::EncodedImage::createIndex(void) {
+    this->data_start = this->reader->get_position();
+
+    if (this->adaptive || this->progressive) {
+        return;
+    }
+
+    dc::dispatchBlockSize(this->getBlockSize(), [this](auto bsize) {
+        this->ranges = ImageProcessor::getBlockRanges<decltype(bsize)::value>();
+        return true;
+    });
+
+    // Without a block index or tiles, the Block data is one range
+    if (this->ranges.empty()) {
+        this->ranges.push_back(dc::BlockRange { 0u, 0u });
+    }
+
+    const size_t block_count = (this->width / this->getBlockSize()) * (this->height / this->getBlockSize());
+
+    this->parsed.assign(this->ranges.size(), 0u);
+    this->offsets.assign(block_count + 1u, 0u);
+    this->sources.assign(block_count, dc::EncodedImage::NO_SOURCE);
+
+    for (const dc::BlockRange &range : this->ranges) {
+        this->offsets[range.first] = range.offset;
+    }
+
+    util::Logger::WriteLn(std::string_format("[EncodedImage] Loaded %dx%d image (%dx%d blocks), %d Blocks start at a known offset.",
+                                             this->width, this->height, this->getBlockSize(), this->getBlockSize(),
+                                             this->ranges.size()));
+}
+
+/**
+ *  @brief  Check whether pixels can be read from the image, nothing is decoded yet.
+ *
+ *  @return Returns false for adaptive Block sizes or the progressive layout.
+ */
+bool dc::EncodedImage::process(void) {
+    if (this->adaptive || this->progressive) {
+        util::Logger::WriteLn("[EncodedImage] Adaptive Block sizes and progressive images are not supported, use the ImageDecoder!");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *  @brief  Get the Block in stream order that contains a pixel, in tile order for a tiled image.
+ */
+size_t dc::EncodedImage::getBlockAt(const size_t x, const size_t y) const {
+    const size_t bsize = this->getBlockSize();
+
+    if (this->tile_size == 0u) {
+        return (y / bsize) * (this->width / bsize) + x / bsize;
+    }
+
+    // Every full row of tiles above, then every tile to the left in the same row of tiles
+    const size_t tiles_x = (this->width + this->tile_size - 1u) / this->tile_size;
+    const dc::TileRect tile = this->getTileRect((y / this->tile_size) * tiles_x + x / this->tile_size);
+
+    return (tile.y / bsize) * (this->width / bsize)
+         + (tile.x / bsize) * (tile.height / bsize)
+         + ((y - tile.y) / bsize) * (tile.width / bsize) + (x - tile.x) / bsize;
+}
+
+/**
+ *  @brief  Get the Block with the coefficients of a Block, finding the offsets of the Blocks up to it.
+ *
+ *          The Blocks of the range that contains the Block are parsed from the last Block
+ *          with a known offset (see Block::SkipInStream()), so the work is bounded by the
+ *          distance between two entries of the block or tile index.
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  id
+ *      The Block in stream order.
+ *  @return Returns the Block to load the coefficients of (id itself, unless it is a reference),
+ *          or NO_SOURCE for a corrupt reference.
+ */
+template<size_t bsize>
+size_t dc::EncodedImage::findSource(const size_t id) {
+    // The last range that starts at or before the Block
+    const auto next = std::upper_bound(this->ranges.begin(), this->ranges.end(), id,
+                                       [](const size_t b, const dc::BlockRange &range) { return b < range.first; });
+    const size_t r  = size_t(next - this->ranges.begin()) - 1u;
+    const size_t first = this->ranges[r].first;
+
+    util::BitStreamReader reader(this->reader->get_buffer(), this->reader->get_size());
+
+    for (size_t b = first + this->parsed[r]; b <= id; b++, this->parsed[r]++) {
+        reader.set_position(this->data_start + this->offsets[b]);
+
+        if (this->deduplicated && reader.get_bit() != 0u) {
+            const size_t ref = reader.get(ImageProcessor::getReferenceLength(this->unique.size()));
+
+            this->sources[b] = ref < this->unique.size() ? this->unique[ref] : dc::EncodedImage::NO_SOURCE;
+        } else {
+            dc::Block<bsize>::SkipInStream(reader, this->use_rle);
+
+            this->sources[b] = b;
+
+            if (this->deduplicated) {
+                this->unique.push_back(b);
+            }
+        }
+
+        this->offsets[b + 1u] = reader.get_position() - this->data_start;
+    }
+
+    return this->sources[id];
+}
+
+/**
+ *  @brief  Load, transform and expand a single Block.
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  id
+ *      The Block in stream order.
+ *  @param  pixels
+ *      Output for the (bsize*bsize) pixels, with bsize as stride.
+ */
+template<size_t bsize>
+void dc::EncodedImage::decodeBlock(const size_t id, uint8_t * const pixels) {
+    const size_t source = this->findSource<bsize>(id);
+
+    alignas(dc::BlockPlane<bsize>::ALIGNMENT) int16_t coefficients[bsize * bsize] = {};
+    dc::Block<bsize> b(dc::BlockView { pixels, bsize, 0u, 0u }, coefficients);
+
+    if (source != dc::EncodedImage::NO_SOURCE) {
+        util::BitStreamReader reader(this->reader->get_buffer(), this->reader->get_size());
+        reader.set_position(this->data_start + this->offsets[source] + (this->deduplicated ? 1u : 0u));
+
+        b.loadFromStream(reader, this->use_rle);
+    }
+
+    b.processIDCTMulQ(this->quant_m.getZigzagData());
+    b.expand();
+}
+
+/**
+ *  @brief  Get the pixels of a Block from the cache, or decode it (see decodeBlock()).
+ *          When the cache is full, the least recently used Block is replaced.
+ *
+ *  @param  id
+ *      The Block in stream order.
+ *  @return Returns the (size*size) pixels with the Block size as stride,
+ *          valid until the next call.
+ */
+const uint8_t* dc::EncodedImage::getBlockPixels(const size_t id) {
+    const auto found = this->cache_index.find(id);
+
+    if (found != this->cache_index.end()) {
+        this->cache.splice(this->cache.begin(), this->cache, found->second);
+        return found->second->pixels;
+    }
+
+    if (this->cache.size() < this->cache_capacity) {
+        this->cache.emplace_front();
+    } else {
+        this->cache_index.erase(this->cache.back().id);
+        this->cache.splice(this->cache.begin(), this->cache, std::prev(this->cache.end()));
+    }
+
+    CachedBlock &entry = this->cache.front();
+    entry.id = id;
+    this->cache_index[id] = this->cache.begin();
+
+    dc::dispatchBlockSize(this->getBlockSize(), [&](auto bsize) {
+        this->decodeBlock<decltype(bsize)::value>(id, entry.pixels);
+        return true;
+    });
+
+    this->decoded_blocks++;
+
+    return entry.pixels;
+}
+
+/**
+ *  @brief  Get the value of a single pixel, decoding only the Block that contains it.
+ *
+ *  @param  value
+ *      Output for the pixel value.
+ *  @return Returns false if the pixel is outside the image or the image is not supported (see process()).
+ */
+bool dc::EncodedImage::getPixel(const size_t x, const size_t y, uint8_t &value) {
+    if (x >= this->width || y >= this->height || this->offsets.empty()) {
+        return false;
+    }
+
+    const size_t bsize = this->getBlockSize();
+
+    value = this->getBlockPixels(this->getBlockAt(x, y))[(y % bsize) * bsize + x % bsize];
+
+    return true;
+}
+
+/**
+ *  @brief  Get the pixels of a region, decoding only the Blocks that intersect it.
+ *
+ *  @param  region
+ *      The pixel rectangle to get, inside the image.
+ *  @param  result
+ *      Output for the (region.width*region.height) pixels, row by row.
+ *  @return Returns false if the region is not inside the image or the image is not supported (see process()).
+ */
+bool dc::EncodedImage::getRegion(const dc::TileRect &region, uint8_t * const result) {
+    if (region.width == 0u || region.height == 0u
+        || region.x + region.width > this->width || region.y + region.height > this->height
+        || this->offsets.empty())
+    {
+        return false;
+    }
+
+    const size_t bsize = this->getBlockSize();
+
+    for (size_t by = region.y - region.y % bsize; by < region.y + region.height; by += bsize) {
+        const size_t y0 = std::max(by, region.y);
+        const size_t y1 = std::min(by + bsize, region.y + region.height);
+
+        for (size_t bx = region.x - region.x % bsize; bx < region.x + region.width; bx += bsize) {
+            const size_t x0 = std::max(bx, region.x);
+            const size_t x1 = std::min(bx + bsize, region.x + region.width);
+            const uint8_t *pixels = this->getBlockPixels(this->getBlockAt(bx, by));
+
+            for (size_t y = y0; y < y1; y++) {
+                std::copy(&pixels[(y - by) * bsize + (x0 - bx)], &pixels[(y - by) * bsize + (x1 - bx)],
+                          &result[(y - region.y) * region.width + (x0 - region.x)]);
+            }
+        }
+    }
+
+    return true;
+}
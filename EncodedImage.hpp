@@ -0,0 +1,85 @@
+#ifndef ENCODEDIMAGE_HPP
+#define ENCODEDIMAGE_HPP
+
+#include "ImageBase.hpp"
+
+#include <list>
+#include <unordered_map>
+
+namespace dc {
+    /**
+     *  @brief  The EncodedImage class
+     *          A handle to an image that was encoded by the ImageEncoder class, to read single pixels
+     *          or small regions without decoding the entire image.
+     *          The header is read once, the bit offset of a Block is found when it is first needed
+     *          (starting from the nearest entry of the block or tile index) and kept,
+     *          and the most recently decoded Blocks are kept in a cache of a fixed amount of Blocks.
+     *          Adaptive Block sizes and the progressive layout are not supported.
+     *          A handle must not be used by multiple threads at once.
+     */
+    class EncodedImage : public ImageProcessor {
+        private:
+            /**
+             *  @brief  The pixels of a decoded Block, with the Block size as stride.
+             */
+            struct CachedBlock {
+                size_t  id;     ///< The Block in stream order.
+                uint8_t pixels[dc::MaxBlockSize * dc::MaxBlockSize];
+            };
+
+            size_t data_start;              ///< Bit position of the Block data in the reader.
+            std::vector<dc::BlockRange> ranges;   ///< The Blocks that start at a known offset (at least the first Block).
+            std::vector<size_t> parsed;     ///< For every range, the amount of Blocks with a known offset and source.
+            std::vector<size_t> offsets;    ///< Bit offset of every Block, relative to data_start (valid if parsed).
+            std::vector<size_t> sources;    ///< The Block with the coefficients of every Block (itself, unless deduplicated).
+            std::vector<size_t> unique;     ///< Every Block that is not a reference, in stream order (deduplicated only).
+
+            size_t cache_capacity;          ///< The maximum amount of decoded Blocks to keep.
+            std::list<CachedBlock> cache;   ///< The decoded Blocks, most recently used first.
+            std::unordered_map<size_t, std::list<CachedBlock>::iterator> cache_index;  ///< The entry for every cached Block.
+            size_t decoded_blocks;          ///< The amount of Blocks decoded so far.
+
+            void createIndex(void);
+            size_t getBlockAt(const size_t, const size_t) const;
+            const uint8_t* getBlockPixels(const size_t);
+
+            template<size_t bsize>
+            size_t findSource(const size_t);
+            template<size_t bsize>
+            void decodeBlock(const size_t, uint8_t * const);
+
+            static constexpr size_t NO_SOURCE = SIZE_MAX;   ///< The source of a Block with a corrupt reference, it stays empty.
+
+        public:
+            EncodedImage(const std::string &source_file, const size_t cache_blocks = 1024u);
+            EncodedImage(uint8_t * const data, const size_t length, const size_t cache_blocks = 1024u);
+            ~EncodedImage(void);
+
+            bool process(void);
+            bool getPixel(const size_t x, const size_t y, uint8_t &value);
+            bool getRegion(const dc::TileRect &region, uint8_t * const result);
+
+            /**
+             *  @brief  Get the width of the image in pixels.
+             */
+            inline size_t getWidth(void) const {
+                return this->width;
+            }
+
+            /**
+             *  @brief  Get the height of the image in pixels.
+             */
+            inline size_t getHeight(void) const {
+                return this->height;
+            }
+
+            /**
+             *  @brief  Get the amount of Blocks decoded so far (a Block evicted from the cache is decoded again).
+             */
+            inline size_t getDecodedBlocks(void) const {
+                return this->decoded_blocks;
+            }
+    };
+}
+
+#endif // ENCODEDIMAGE_HPP
@@ -7,7 +7,7 @@ uint8_t dc::Frame::MVEC_BIT_SIZE;
 
 
 dc::Frame::Frame(uint8_t * const raw, Frame * const reference_frame,
-                 const uint16_t& width, const uint16_t& height,
+                 const uint32_t& width, const uint32_t& height,
                  const bool &use_rle, MatrixReader<> &quant_m, bool i_frame)
     : ImageProcessor(raw, width, height, use_rle, quant_m)
     , is_i_frame(i_frame)
@@ -25,7 +25,7 @@ size_t dc::Frame::streamSize(void) const {
     // Encode  isIFrame() : std::reduce(this->blocks, [](const Block<>& b) { return b.streamSize(); }, 0)
     // Encode !isIFrame() : (this->width * this->height) / (dc::MacroBlockSize * dc::MacroBlockSize) * dc::Frame::VectorBits * 2
 
-    return this->width * this->height * 8u;
+    return size_t(this->width) * this->height * 8u;
 }
 
 void dc::Frame::streamEncoded(util::BitStreamWriter& writer) const {
@@ -45,35 +45,57 @@ void dc::Frame::streamEncoded(util::BitStreamWriter& writer) const {
 }
 
 void dc::Frame::loadFromStream(util::BitStreamReader &reader, bool motioncomp) {
-    const size_t frame_bytes = this->width * this->height;
+    const size_t frame_bytes = size_t(this->width) * this->height;
     const size_t UV_bytes    = frame_bytes / 2;
     const size_t frame_size  = frame_bytes + UV_bytes;  // 2/3 Y + 1/3 UV data
 
-    this->writer = util::allocVar<util::BitStreamWriter>(frame_size);
+    // Zeroed for pixels that are not covered by a Block
+    this->writer = util::allocVar<util::BitStreamWriter>(frame_size, util::PLANE_ZEROED | util::PLANE_HUGE_PAGES);
+
+    const bool success = dc::dispatchBlockSize(this->getBlockSize(), [&](auto bsize) {
+        return this->loadBlocksFromStream<decltype(bsize)::value>(reader, motioncomp);
+    });
+
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[Frame] Unsupported block size %d!",
+                                                 this->getBlockSize()));
+    }
+
+    // For expanding to decoded, fill UV data
+    std::fill_n(this->writer->get_buffer() + frame_bytes,
+                UV_bytes,
+                dc::VIDEO_UV_FILL);
+
+    this->writer->set_position(this->writer->get_size() * 8u);
+}
+
+template<size_t bsize>
+bool dc::Frame::loadBlocksFromStream(util::BitStreamReader &reader, bool motioncomp) {
+    dc::BlockList<bsize> *blocks = nullptr;
 
     if (this->isIFrame()) {
         // Frame contains only MicroBlocks
 
         util::Logger::WriteLn("[IFrame] Creating MicroBlocks...");
-        dc::ImageProcessor::process(this->writer->get_buffer());
+        blocks = dc::ImageProcessor::createBlocks<bsize>(this->writer->get_buffer());
 
         #ifdef ENABLE_OPENMP
             // Reading raw must happen in sequence
-            for (MicroBlock* b : *this->blocks) {
-                b->loadFromStream(reader, this->use_rle);
+            for (Block<bsize>& b : *blocks) {
+                b.loadFromStream(reader, this->use_rle);
             }
 
             #pragma omp parallel for schedule(dynamic)
-            for (auto it = this->blocks->begin(); it < this->blocks->end(); it++) {
-                Block<> *b = *it;
-                b->processIDCTMulQ(this->quant_m.getData());
-                b->expand();
+            for (auto it = blocks->begin(); it < blocks->end(); it++) {
+                Block<bsize> &b = *it;
+                b.processIDCTMulQ(this->quant_m.getZigzagData());
+                b.expand();
             }
         #else
-            for (MicroBlock* b : *this->blocks) {
-                b->loadFromStream(reader, this->use_rle);
-                b->processIDCTMulQ(this->quant_m.getData());
-                b->expand();
+            for (Block<bsize>& b : *blocks) {
+                b.loadFromStream(reader, this->use_rle);
+                b.processIDCTMulQ(this->quant_m.getZigzagData());
+                b.expand();
             }
         #endif
     } else {
@@ -82,35 +104,35 @@ void dc::Frame::loadFromStream(util::BitStreamReader &reader, bool motioncomp) {
         util::Logger::WriteLn("[PFrame] Recreating MacroBlocks...");
         dc::ImageProcessor::processMacroBlocks(this->writer->get_buffer());
 
-        for (MacroBlock* b : *this->macroblocks) {
-            b->loadFromReferenceStream(reader, this->reference_frame);
+        for (MacroBlock& b : *this->macroblocks) {
+            b.loadFromReferenceStream(reader, this->reference_frame);
         }
 
         util::Logger::WriteLn("[PFrame] Recreating MicroBlocks (for motion compansation if enabled)...");
-        dc::ImageProcessor::process(this->writer->get_buffer());
+        blocks = dc::ImageProcessor::createBlocks<bsize>(this->writer->get_buffer());
 
         #ifdef ENABLE_OPENMP
             // Reading raw must happen in sequence
-            for (MicroBlock* b : *this->blocks) {
-                b->loadFromStream(reader, this->use_rle);
+            for (Block<bsize>& b : *blocks) {
+                b.loadFromStream(reader, this->use_rle);
             }
 
             if (motioncomp) {
                 #pragma omp parallel for schedule(dynamic)
-                for (auto it = this->blocks->begin(); it < this->blocks->end(); it++) {
-                    Block<> *b = *it;
-                    b->processIDCTMulQ(this->quant_m.getData());
-                    b->expandDifferences();
+                for (auto it = blocks->begin(); it < blocks->end(); it++) {
+                    Block<bsize> &b = *it;
+                    b.processIDCTMulQ(this->quant_m.getZigzagData());
+                    b.expandDifferences();
                 }
             }
         #else
-            for (MicroBlock* b : *this->blocks) {
-                b->loadFromStream(reader, this->use_rle);
+            for (Block<bsize>& b : *blocks) {
+                b.loadFromStream(reader, this->use_rle);
 
                 if (motioncomp) {
                     // Decode prediction errors
-                    b->processIDCTMulQ(this->quant_m.getData());
-                    b->expandDifferences();
+                    b.processIDCTMulQ(this->quant_m.getZigzagData());
+                    b.expandDifferences();
                 } else {
                     // Just consume the prediction error compensation iframe
                 }
@@ -118,43 +140,57 @@ void dc::Frame::loadFromStream(util::BitStreamReader &reader, bool motioncomp) {
         #endif
     }
 
-    // For expanding to decoded, fill UV data
-    std::fill_n(this->writer->get_buffer() + frame_bytes,
-                UV_bytes,
-                dc::VIDEO_UV_FILL);
+    util::deallocVar(blocks);
 
-    this->writer->set_position(this->writer->get_size() * 8u);
+    return true;
 }
 
 bool dc::Frame::process(void) {
+    const bool success = dc::dispatchBlockSize(this->getBlockSize(), [this](auto bsize) {
+        return this->processBlocks<decltype(bsize)::value>();
+    });
+
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[Frame] Unsupported block size %d!",
+                                                 this->getBlockSize()));
+    }
+
+    return success;
+}
+
+template<size_t bsize>
+bool dc::Frame::processBlocks(void) {
+    dc::BlockList<bsize> *blocks = nullptr;
+
     if (this->isIFrame()) {
         util::Logger::WriteLn("[IFrame] Creating MicroBlocks...");
-        dc::ImageProcessor::process(this->reader->get_buffer());
+        blocks = dc::ImageProcessor::createBlocks<bsize>(this->reader->get_buffer());
 
-        const size_t output_length = util::round_to_byte(this->blocks->size()
-                                                       * this->blocks->front()->streamSize());
+        const size_t output_length = util::round_to_byte(blocks->size()
+                                                       * (*blocks)[0].streamSize());
 
-        this->writer = util::allocVar<util::BitStreamWriter>(output_length);
+        this->writer = util::allocVar<util::BitStreamWriter>(output_length, util::PLANE_UNINITIALISED);
 
         util::Logger::WriteLn("[IFrame] Processing MicroBlocks...");
 
         #ifdef ENABLE_OPENMP
             #pragma omp parallel for schedule(dynamic)
-            for (auto it = this->blocks->begin(); it < this->blocks->end(); it++) {
-                MicroBlock *b = *it;
-                b->processDCTDivQ(this->quant_m.getData());
-                b->createRLESequence();
+            for (auto it = blocks->begin(); it < blocks->end(); it++) {
+                Block<bsize> &b = *it;
+                b.processDCTDivQ(this->quant_m.getZigzagData());
+                b.createRLESequence();
             }
 
-            // Writing results must happen in sequence
-            for (MicroBlock* b : *this->blocks) {
-                b->streamEncoded(*this->writer, this->use_rle);
-            }
+            // Writing results must happen in sequence, so every thread writes its own range
+            ImageProcessor::streamParallel(blocks->size(), Block<bsize>::MAX_STREAM_BITS,
+                                           [&](const size_t i, util::BitStreamWriter &writer) {
+                (*blocks)[i].streamEncoded(writer, this->use_rle);
+            });
         #else
-            for (MicroBlock* b : *this->blocks) {
-                b->processDCTDivQ(this->quant_m.getData());
-                b->createRLESequence();
-                b->streamEncoded(*this->writer, this->use_rle);
+            for (Block<bsize>& b : *blocks) {
+                b.processDCTDivQ(this->quant_m.getZigzagData());
+                b.createRLESequence();
+                b.streamEncoded(*this->writer, this->use_rle);
             }
         #endif
     } else {
@@ -163,89 +199,86 @@ bool dc::Frame::process(void) {
         dc::ImageProcessor::processMacroBlocks(this->reader->get_buffer());
 
         // Also create MicroBlocks to encode expanded motion prediction errors
-        dc::ImageProcessor::process(this->reader->get_buffer());
+        blocks = dc::ImageProcessor::createBlocks<bsize>(this->reader->get_buffer());
 
         // Output for all
         const size_t output_length = (this->macroblocks->size()
                                        * dc::Frame::MVEC_BIT_SIZE * 2)  ///< 2 values for mvec for each block
                                    + util::round_to_byte(              ///< Size of resulting predict error iframe
-                                         this->blocks->size()
-                                       * this->blocks->front()->streamSize());
+                                         blocks->size()
+                                       * (*blocks)[0].streamSize());
 
         // Final output for PFrame (mvecs + encoded me-error frame)
-        this->writer = util::allocVar<util::BitStreamWriter>(output_length);
+        this->writer = util::allocVar<util::BitStreamWriter>(output_length, util::PLANE_UNINITIALISED);
 
         util::Logger::WriteLn("[PFrame] Processing MacroBlocks...");
 
         #ifdef ENABLE_OPENMP
             #pragma omp parallel for schedule(dynamic)
             for (auto it = this->macroblocks->begin(); it < this->macroblocks->end(); it++) {
-                MacroBlock *b = *it;
-                b->processFindMotionOffset(this->reference_frame);
-                this->copyMacroblockToMatchingMicroblocks(*b);
-
-                const algo::MER_level_t mvec_coord = b->getCoordAfterMotion();
-                dc::MacroBlock *ref_block = this->reference_frame->getBlockAtCoord(
-                                                mvec_coord.x0, mvec_coord.y0);
-                ref_block->copyBlockMatrixTo(*b);
-                util::deallocVar(ref_block);
-            }
+                MacroBlock &b = *it;
+                b.processFindMotionOffset(this->reference_frame);
+                this->copyMacroblockToMatchingMicroblocks(b, *blocks);
 
-            // Writing results must happen in sequence
-            for (MacroBlock* b : *this->macroblocks) {
-                b->streamMVec(*this->writer);
+                const algo::MER_level_t mvec_coord = b.getCoordAfterMotion();
+                b.copyMatrixFrom(this->reference_frame->getViewAtCoord(mvec_coord.x0, mvec_coord.y0));
             }
 
+            // Writing results must happen in sequence, so every thread writes its own range
+            ImageProcessor::streamParallel(this->macroblocks->size(), dc::Frame::MVEC_BIT_SIZE * 2u,
+                                           [&](const size_t i, util::BitStreamWriter &writer) {
+                (*this->macroblocks)[i].streamMVec(writer);
+            });
+
             #pragma omp parallel for schedule(dynamic)
-            for (auto it = this->blocks->begin(); it < this->blocks->end(); it++) {
-                MicroBlock *b = *it;
-                b->expandDifferences();
+            for (auto it = blocks->begin(); it < blocks->end(); it++) {
+                Block<bsize> &b = *it;
+                b.expandDifferences();
             }
 
-            // Writing results must happen in sequence
-            for (MicroBlock* b : *this->blocks) {
-                b->streamEncoded(*this->writer, this->use_rle);
-            }
+            ImageProcessor::streamParallel(blocks->size(), Block<bsize>::MAX_STREAM_BITS,
+                                           [&](const size_t i, util::BitStreamWriter &writer) {
+                (*blocks)[i].streamEncoded(writer, this->use_rle);
+            });
         #else
-            for (MacroBlock* b : *this->macroblocks) {
-                b->processFindMotionOffset(this->reference_frame);
+            for (MacroBlock& b : *this->macroblocks) {
+                b.processFindMotionOffset(this->reference_frame);
 
-                // Motion vector offset now in b->mvec
-                // Actual vector offset = b->mvec + b->mvec_this
-                // Prediction error now within b->expanded
+                // Motion vector offset now in b.mvec
+                // Actual vector offset = b.mvec + b.mvec_this
+                // Prediction error now within b.expanded
 
-                // Expand b->expanded to the same Microbloks->expanded and encode
-                this->copyMacroblockToMatchingMicroblocks(*b);
+                // Expand b.expanded to the same Microbloks->expanded and encode
+                this->copyMacroblockToMatchingMicroblocks(b, *blocks);
 
                 // Copy ref_frame MacroBlock to this, for better motion estimation in next frame
-                const algo::MER_level_t mvec_coord = b->getCoordAfterMotion();
-                dc::MacroBlock *ref_block = this->reference_frame->getBlockAtCoord(
-                                                mvec_coord.x0, mvec_coord.y0);
-                ref_block->copyBlockMatrixTo(*b);
-                util::deallocVar(ref_block);
+                const algo::MER_level_t mvec_coord = b.getCoordAfterMotion();
+                b.copyMatrixFrom(this->reference_frame->getViewAtCoord(mvec_coord.x0, mvec_coord.y0));
 
                 // Write mvec for each frame to output
-                b->streamMVec(*this->writer);
+                b.streamMVec(*this->writer);
             }
 
-            // this->blocks[*]->expanded now has the expanded values from this->macroblocks
+            // blocks[*]->expanded now has the expanded values from this->macroblocks
             // Process them now again as IFrame
             // + Write Prediction error IFrame after mvecs
-            for (MicroBlock* b : *this->blocks) {
+            for (Block<bsize>& b : *blocks) {
                 // Expand previously encoded and decoded diffs back into self
-                // b->matrix was already replaced by ref_frame (copyBlockMatrixTo),
-                // b->expanded still contains decoded diffs, so just add back together.
-                b->expandDifferences();
+                // b's pixels were already replaced by ref_frame (copyMatrixFrom),
+                // b.expanded still contains decoded diffs, so just add back together.
+                b.expandDifferences();
 
                 // Write previously encoded RLE sequence to stream
-                b->streamEncoded(*this->writer, this->use_rle);
+                b.streamEncoded(*this->writer, this->use_rle);
             }
         #endif
     }
 
+    util::deallocVar(blocks);
+
     return true;
 }
 
-dc::MacroBlock* dc::Frame::getBlockAtCoord(int16_t x, int16_t y) const {
-    return dc::ImageProcessor::getBlockAtCoord(x, y);
+dc::BlockView dc::Frame::getViewAtCoord(int32_t x, int32_t y) const {
+    return dc::ImageProcessor::getViewAtCoord(x, y);
 }
@@ -18,9 +18,15 @@ namespace dc {
 
             void processFindMotionOffset(MacroBlock * const b) const;
 
+            template<size_t bsize>
+            bool processBlocks(void);
+
+            template<size_t bsize>
+            bool loadBlocksFromStream(util::BitStreamReader& reader, bool);
+
         public:
             Frame(uint8_t * const raw, Frame * const reference_frame,
-                  const uint16_t& width, const uint16_t& height,
+                  const uint32_t& width, const uint32_t& height,
                   const bool &use_rle, MatrixReader<> &quant_m, bool i_frame);
             ~Frame(void);
 
@@ -31,7 +37,7 @@ namespace dc {
 
             void loadFromStream(util::BitStreamReader& reader, bool);
 
-            dc::MacroBlock* getBlockAtCoord(int16_t, int16_t) const;
+            dc::BlockView getViewAtCoord(int32_t, int32_t) const;
 
             bool process(void);
 
@@ -1,4 +1,5 @@
 #include "Huffman.hpp"
+#include <algorithm>
 #include <numeric>
 #include <queue>
 
@@ -242,28 +243,45 @@ util::BitStreamWriter* algo::Huffman<T>::encode(util::BitStreamReader& reader) {
         freqs[word]++;
     }
 
-    // Create priority queue to sort tree with Nodes with data from frequency
-    std::priority_queue<algo::Node<>*, std::vector<algo::Node<>*>, algo::Node<>::comparator> pq;
+    // Codeword lengths must fit in the DICT_HDR_ITEM_BITS of the dict header:
+    // while the tree is too deep, halve the frequencies (keeping every word) and build it again
+    uint32_t max_len = 0u;
 
-    for (const auto& pair: freqs) {
-        pq.push(util::allocVar<algo::Node<>>(pair.first, pair.second));
-        // util::Logger::WriteLn(std::string_format("%02X: %d", pair.first, pair.second), false);
-    }
+    do {
+        // Create priority queue to sort tree with Nodes with data from frequency
+        std::priority_queue<algo::Node<>*, std::vector<algo::Node<>*>, algo::Node<>::comparator> pq;
 
-    while (pq.size() > 1) {
-        // Empty out queue and build leaves, starting with lowest freq
-        // Result is a single Node with references to other Nodes in tree structure.
-        algo::Node<> *left  = pq.top(); pq.pop();
-        algo::Node<> *right = pq.top(); pq.pop();
+        for (const auto& pair: freqs) {
+            pq.push(util::allocVar<algo::Node<>>(pair.first, pair.second));
+            // util::Logger::WriteLn(std::string_format("%02X: %d", pair.first, pair.second), false);
+        }
 
-        pq.push(util::allocVar<algo::Node<>>(-1, left->freq + right->freq, left, right));
-    }
+        while (pq.size() > 1) {
+            // Empty out queue and build leaves, starting with lowest freq
+            // Result is a single Node with references to other Nodes in tree structure.
+            algo::Node<> *left  = pq.top(); pq.pop();
+            algo::Node<> *right = pq.top(); pq.pop();
+
+            pq.push(util::allocVar<algo::Node<>>(-1, left->freq + right->freq, left, right));
+        }
 
-    // Huffman tree root
-    this->tree_root = pq.top();
+        // Huffman tree root
+        util::deallocVar(this->tree_root);
+        this->tree_root = pq.top();
 
-    // Create dictionary by tree traversal
-    this->buildDict(this->tree_root, std::vector<bool>());
+        // Create dictionary by tree traversal
+        this->dict.clear();
+        this->buildDict(this->tree_root, std::vector<bool>());
+
+        max_len = 0u;
+        for (const auto& w : this->dict) {
+            max_len = std::max(max_len, w.second.len);
+        }
+
+        for (auto& pair : freqs) {
+            pair.second = (pair.second >> 1u) | 1u;
+        }
+    } while (max_len > algo::Huffman<>::MAX_CODEWORD_BITS);
 
     // Create new list with dict elements sorted by bit length for saving to stream
     std::vector<std::pair<uint8_t, algo::Codeword>> sorted_dict(this->dict.begin(), this->dict.end());
@@ -284,22 +302,28 @@ util::BitStreamWriter* algo::Huffman<T>::encode(util::BitStreamReader& reader) {
                                + 1;                                               // Stop bit
     for (const auto& f : bit_freqs) {
         h_dict_total_length += f.first * f.second;  // Amount of bits for each header group
+
+        // Extra headers when a group is split, see below
+        h_dict_total_length += ((f.second - 1u) / algo::Huffman<>::MAX_DICT_SEQ_LENGTH)
+                             * (algo::Huffman<>::DICT_HDR_HAS_ITEMS_BITS + algo::Huffman<>::DICT_HDR_ITEM_BITS + algo::Huffman<>::DICT_HDR_SEQ_LENGTH_BITS);
     }
 
     util::Logger::WriteLn(std::string_format("[Huffman] Table overhead with %d entries: %.1f bytes.",
                                              this->dict.size(), float(h_dict_total_length) / 8.0f));
 
     // Save the Huffman dictionary to a stream
-    util::BitStreamWriter *writer = util::allocVar<util::BitStreamWriter>((h_dict_total_length + length) / 8 + 1);
+    util::BitStreamWriter *writer = util::allocVar<util::BitStreamWriter>((h_dict_total_length + length) / 8 + 1,
+                                                                         util::PLANE_UNINITIALISED);
     uint32_t seq_len = 0u, bit_len = 0u;
 
     // Add headers for each group of same length key:val pairs
-    // and write them to the stream
+    // and write them to the stream, groups longer than DICT_HDR_SEQ_LENGTH_BITS allow are split
     for (const auto& w : sorted_dict) {
         if (seq_len == 0) {
             // New group
             bit_len = w.second.len;
-            seq_len = bit_freqs[bit_len];
+            seq_len = std::min(bit_freqs[bit_len], algo::Huffman<>::MAX_DICT_SEQ_LENGTH);
+            bit_freqs[bit_len] -= seq_len;
             this->add_huffman_dict_header(seq_len, bit_len, *writer);
         }
 
@@ -329,7 +353,7 @@ util::BitStreamWriter* algo::Huffman<T>::encode(util::BitStreamReader& reader) {
     if (original_length < total_length) {
         util::Logger::WriteLn("[Huffman] No extra compression achieved, reverting stream to encoded.");
         util::deallocVar(writer);
-        writer = util::allocVar<util::BitStreamWriter>(original_length);
+        writer = util::allocVar<util::BitStreamWriter>(original_length, util::PLANE_UNINITIALISED);
         writer->put_bit(0);
 
         reader.reset();
@@ -371,7 +395,7 @@ util::BitStreamReader* algo::Huffman<T>::decode(util::BitStreamReader& reader) {
         return result;
     } else {
         // Consume all other data, bit by bit and traverse Huffman tree to find word
-        util::BitStreamWriter *writer = util::allocVar<util::BitStreamWriter>(data_bytes);
+        util::BitStreamWriter *writer = util::allocVar<util::BitStreamWriter>(data_bytes, util::PLANE_UNINITIALISED);
 
         while (reader.get_position() < raw_bits) {
             this->decode(reader, *writer);
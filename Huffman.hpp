@@ -139,6 +139,9 @@ namespace algo {
             static constexpr size_t DICT_HDR_HAS_ITEMS_BITS  = 1u;  ///< Whether there are dictionary items following (bit length)
             static constexpr size_t DICT_HDR_SEQ_LENGTH_BITS = 7u;  ///< Amunt of bits to represent the length of following items
             static constexpr size_t DICT_HDR_ITEM_BITS       = 4u;  ///< Amunt of bits to represent the length of following items
+
+            static constexpr uint32_t MAX_DICT_SEQ_LENGTH = (1u << DICT_HDR_SEQ_LENGTH_BITS) - 1u;  ///< Maximum amount of items after one dict header
+            static constexpr uint32_t MAX_CODEWORD_BITS   = (1u << DICT_HDR_ITEM_BITS) - 1u;        ///< Maximum bit length of a codeword
     };
 
     extern template class algo::Node<uint8_t>;
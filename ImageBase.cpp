@@ -4,6 +4,10 @@
 #include "Block.hpp"
 #include "Huffman.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
 static const std::string NO_VALUE("");
 
 /**
@@ -16,17 +20,17 @@ static const std::string NO_VALUE("");
  *  @param  height
  *      The height in pixels for the image.
  */
-dc::ImageBase::ImageBase(const std::string &source_file, const uint16_t &width, const uint16_t &height)
+dc::ImageBase::ImageBase(const std::string &source_file, const uint32_t &width, const uint32_t &height)
     : width(width), height(height)
 {
     try {
-        this->raw = util::readBinaryFile(source_file);
+        this->raw = util::readBinaryFile(source_file, this->raw_size);
     } catch (Exceptions::FileReadException const& e) {
         util::Logger::WriteLn(e.getMessage());
         exit(-1);
     }
 
-    this->reader = util::allocVar<util::BitStreamReader>(this->raw->data(), this->raw->size());
+    this->reader = util::allocVar<util::BitStreamReader>(this->raw, this->raw_size);
 }
 
 /**
@@ -39,20 +43,38 @@ dc::ImageBase::ImageBase(const std::string &source_file, const uint16_t &width,
  *  @param  height
  *      The height in pixels for the image.
  */
-dc::ImageBase::ImageBase(uint8_t * const raw, const uint16_t &width, const uint16_t &height)
+dc::ImageBase::ImageBase(uint8_t * const raw, const uint32_t &width, const uint32_t &height)
     : width(width), height(height)
     , raw(nullptr)
-    , reader(util::allocVar<util::BitStreamReader>(raw, width * height))
+    , raw_size(0u)
+    , reader(util::allocVar<util::BitStreamReader>(raw, size_t(width) * height))
 {
     // Empty
 }
 
+/**
+ *  @brief  Ctor for an encoded stream in memory (e.g. a level of a pyramid, see PyramidDecoder),
+ *          the dimensions are read from the stream. The stream is not owned.
+ *
+ *  @param  data
+ *      Pointer to the first byte of the encoded stream.
+ *  @param  length
+ *      The length of the encoded stream in bytes.
+ */
+dc::ImageBase::ImageBase(uint8_t * const data, const size_t length)
+    : width(0u), height(0u)
+    , raw(nullptr)
+    , raw_size(length)
+    , reader(util::allocVar<util::BitStreamReader>(data, length))
+{
+    // Empty
+}
 
 /**
  *  @brief  Default dtor
  */
 dc::ImageBase::~ImageBase(void) {
-    util::deallocVar(this->raw);
+    util::deallocPlane(this->raw);
     util::deallocVar(this->reader);
 }
 
@@ -77,12 +99,14 @@ dc::ImageBase::~ImageBase(void) {
  */
 dc::ImageProcessor::ImageProcessor(const std::string &source_file,
                                    const std::string &dest_file,
-                                   const uint16_t &width, const uint16_t &height,
+                                   const uint32_t &width, const uint32_t &height,
                                    const bool &use_rle, MatrixReader<> &quant_m)
     : ImageBase(source_file, width, height),
-      use_rle(use_rle), quant_m(quant_m),
+      use_rle(use_rle), adaptive(false), progressive(false), deduplicated(false), quant_m(quant_m),
+      index_interval(0u), tile_size(0u),
       dest_file(dest_file),
-      blocks(util::allocVar<std::vector<Block<>*>>())
+      macroblocks(nullptr),
+      writer(nullptr)
 {
     // Empty
 }
@@ -97,11 +121,48 @@ dc::ImageProcessor::ImageProcessor(const std::string &source_file,
  */
 dc::ImageProcessor::ImageProcessor(const std::string &source_file, const std::string &dest_file)
     : ImageBase(source_file, 0u, 0u)                            ///< Create stream
+    , adaptive(false)
+    , progressive(false)
+    , deduplicated(false)
+    , index_interval(0u)
+    , tile_size(0u)
     , dest_file(dest_file)
-    , blocks(util::allocVar<std::vector<Block<>*>>())
+    , macroblocks(nullptr)
+    , writer(nullptr)
 {
     // Assume input is encoded image and settings should be determined from the bytestream
+    this->readHeader();
+}
+
+/**
+ *  @brief  Ctor for decoder from an encoded stream in memory, settings need to be determined from the stream.
+ *
+ *  @param  data
+ *      Pointer to the first byte of the encoded stream, it is not owned.
+ *  @param  length
+ *      The length of the encoded stream in bytes.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ */
+dc::ImageProcessor::ImageProcessor(uint8_t * const data, const size_t length, const std::string &dest_file)
+    : ImageBase(data, length)
+    , adaptive(false)
+    , progressive(false)
+    , deduplicated(false)
+    , index_interval(0u)
+    , tile_size(0u)
+    , dest_file(dest_file)
+    , macroblocks(nullptr)
+    , writer(nullptr)
+{
+    this->readHeader();
+}
 
+/**
+ *  @brief  Undo the Huffman encoding of the reader stream (if used)
+ *          and read the settings header written by writeHeader().
+ */
+void dc::ImageProcessor::readHeader(void) {
     // Perform Huffman decompress (if used, first bit is '1' else '0')
     algo::Huffman<> hm;
     util::BitStreamReader *hm_output = hm.decode(*this->reader);
@@ -123,9 +184,47 @@ dc::ImageProcessor::ImageProcessor(const std::string &source_file, const std::st
     this->quant_m = dc::MatrixReader<>::fromBitstream(*this->reader);
 
     // Read other settings in same order as they were presumably written to the encoded stream
-    this->use_rle = this->reader->get(dc::ImageProcessor::RLE_BITS);
-    this->width   = uint16_t(this->reader->get(dc::ImageProcessor::DIM_BITS));
-    this->height  = uint16_t(this->reader->get(dc::ImageProcessor::DIM_BITS));
+    this->use_rle  = this->reader->get(dc::ImageProcessor::RLE_BITS);
+    this->adaptive = this->reader->get(dc::ImageProcessor::ADAPTIVE_BITS);
+
+    std::vector<size_t> dimensions(2u);
+    const bool wide = dc::ImageProcessor::readFields(*this->reader, dimensions);
+    this->width   = uint32_t(dimensions[0]);
+    this->height  = uint32_t(dimensions[1]);
+
+    this->readBlockIndex(*this->reader, wide);
+    this->readTileIndex(*this->reader, wide);
+    this->progressive  = this->reader->get(dc::ImageProcessor::PROGRESSIVE_BITS);
+    this->deduplicated = this->reader->get(dc::ImageProcessor::DEDUP_BITS);
+}
+
+/**
+ *  @brief  Ctor for processors that read their source in parts (see StripEncoder),
+ *          no source stream is loaded.
+ *
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ *  @param  width
+ *      The width in pixels for the image.
+ *  @param  height
+ *      The height in pixels for the image.
+ *  @param  use_rle
+ *      Whether to use Run-Length Encoding.
+ *  @param  quant_m
+ *      The quantization matrix to use.
+ */
+dc::ImageProcessor::ImageProcessor(const std::string &dest_file,
+                                   const uint32_t &width, const uint32_t &height,
+                                   const bool &use_rle, MatrixReader<> &quant_m)
+    : ImageBase(nullptr, width, height)
+    , use_rle(use_rle), adaptive(false), progressive(false), deduplicated(false), quant_m(quant_m)
+    , index_interval(0u)
+    , tile_size(0u)
+    , dest_file(dest_file)
+    , macroblocks(nullptr)
+    , writer(nullptr)
+{
+    // Empty
 }
 
 /**
@@ -144,13 +243,15 @@ dc::ImageProcessor::ImageProcessor(const std::string &source_file, const std::st
  *      The quantization matrix to use.
  */
 dc::ImageProcessor::ImageProcessor(uint8_t * const raw,
-                                   const uint16_t &width, const uint16_t &height,
+                                   const uint32_t &width, const uint32_t &height,
                                    const bool &use_rle, MatrixReader<> &quant_m)
     : ImageBase(raw, width, height)
-    , use_rle(use_rle), quant_m(quant_m)
+    , use_rle(use_rle), adaptive(false), progressive(false), deduplicated(false), quant_m(quant_m)
+    , index_interval(0u)
+    , tile_size(0u)
     , dest_file(NO_VALUE)
-    , blocks(util::allocVar<std::vector<Block<>*>>())
-    , macroblocks(util::allocVar<std::vector<MacroBlock*>>())
+    , macroblocks(nullptr)
+    , writer(nullptr)
 {
     // Empty
 }
@@ -159,150 +260,956 @@ dc::ImageProcessor::ImageProcessor(uint8_t * const raw,
  *  @brief  Default dtor
  */
 dc::ImageProcessor::~ImageProcessor(void) {
-    util::deallocVector(this->blocks);
-    util::deallocVector(this->macroblocks);
+    util::deallocVar(this->macroblocks);
     util::deallocVar(this->writer);
 }
 
 /**
  *  @brief  Start processing by creating blocks for the given stream.
  *
+ *  @tparam bsize
+ *      The Block size to use, should be the same as this->getBlockSize().
  *  @param  source_block_buffer
  *      The source strean te create blocks from.
  *      Usually the reader stream when encoding, and the writer stream when decoding.
- *  @return Returns true on success.
+ *  @param  rows
+ *      The amount of pixel rows in the buffer, this->height for an entire image.
+ *      Tiled images are always created entirely, in tile order.
+ *  @param  scale
+ *      The factor the buffer is smaller than the image (width and height),
+ *      every view then covers (bsize/scale)^2 pixels (see Block::expandScaled()).
+ *  @return Returns a new list with a Block for every (bsize*bsize) pixels,
+ *          deallocate with util::deallocVar().
  */
-bool dc::ImageProcessor::process(uint8_t * const source_block_buffer) {
-    util::Logger::WriteLn("[ImageProcessor] Creating blocks...");
-    uint8_t *block_starts[dc::BlockSize] = { nullptr };
+template<size_t bsize>
+dc::BlockList<bsize>* dc::ImageProcessor::createBlocks(uint8_t * const source_block_buffer, const size_t rows,
+                                                         const size_t scale) const {
+    util::Logger::WriteLn(std::string_format("[ImageProcessor] Creating %dx%d blocks...", bsize, bsize));
 
-    constexpr size_t block_size = dc::BlockSize * dc::BlockSize;    ///< Total values inside 1 Block
-    const     size_t blockx     = this->width  / dc::BlockSize;     ///< Amount of Blocks on a row
-    const     size_t blocky     = this->height / dc::BlockSize;     ///< Amount of Blocks in a column
+    const     size_t blockx     = this->width  / bsize;     ///< Amount of Blocks on a row
+    const     size_t blocky     = rows / bsize;             ///< Amount of Blocks in a column
 
-    // Reserve space for blocks
-    this->blocks->reserve(blockx * blocky);
+    // Allocate space for blocks
+    dc::BlockList<bsize> *blocks = util::allocVar<dc::BlockList<bsize>>(blockx * blocky);
 
-    // Get only pointers to start of each block row and save to Block in this->blocks
-    for (size_t b_y = 0; b_y < blocky; b_y++) {                     ///< Block y coord
-        for (size_t b_x = 0; b_x < blockx; b_x++) {                 ///< Block x coord
-            for (size_t y = 0; y < dc::BlockSize; y++) {            ///< Row inside block
-                block_starts[y] = (source_block_buffer +            // Buffer start
-                                   (  (b_y * block_size * blockx)   // Block row start
-                                    + (b_x * dc::BlockSize)         // Block column start
-                                    + (y * this->width)             // Row within block
-                                    + (0)));                        // Column withing block
-            }
+    if (this->tile_size != 0u) {
+        // Tiled images store the Blocks of every tile together, tile by tile
+        assert(rows == this->height);
+
+        for (size_t t = 0; t < this->getTileCount(); t++) {
+            const dc::TileRect tile = this->getTileRect(t);
 
-            // Create new block with the found row offsets
-            this->blocks->push_back(util::allocVar<dc::Block<>>(block_starts));
+            for (size_t y = tile.y; y < tile.y + tile.height; y += bsize) {
+                for (size_t x = tile.x; x < tile.x + tile.width; x += bsize) {
+                    blocks->add(dc::BlockView { source_block_buffer, this->width / scale, x / scale, y / scale, scale });
+                }
+            }
         }
+
+        return blocks;
     }
 
-    // Create zig-zag-pattern LUT
-    Block<dc::BlockSize>::CreateZigZagLUT();
+    // Save a view of each block inside the buffer to Block in blocks
+    for (size_t b_y = 0; b_y < blocky; b_y++) {                     ///< Block y coord
+        for (size_t b_x = 0; b_x < blockx; b_x++) {                 ///< Block x coord
+            blocks->add(dc::BlockView { source_block_buffer, this->width / scale,
+                                        b_x * bsize / scale, b_y * bsize / scale, scale });
+        }
+    }
 
-    return true;
+    return blocks;
 }
 
+template dc::BlockList< 4u>* dc::ImageProcessor::createBlocks< 4u>(uint8_t * const, const size_t, const size_t) const;
+template dc::BlockList< 8u>* dc::ImageProcessor::createBlocks< 8u>(uint8_t * const, const size_t, const size_t) const;
+template dc::BlockList<16u>* dc::ImageProcessor::createBlocks<16u>(uint8_t * const, const size_t, const size_t) const;
+
 bool dc::ImageProcessor::processMacroBlocks(uint8_t * const source_block_buffer) {
     util::Logger::WriteLn("[ImageProcessor] Creating macro blocks...");
-    uint8_t *block_starts[dc::MacroBlockSize] = { nullptr };
 
-    constexpr size_t block_size = dc::MacroBlockSize * dc::MacroBlockSize;  ///< Total values inside 1 Block
     const     size_t blockx     = this->width  / dc::MacroBlockSize;        ///< Amount of Blocks on a row
     const     size_t blocky     = this->height / dc::MacroBlockSize;        ///< Amount of Blocks in a column
 
-    // Reserve space for blocks
-    this->macroblocks->reserve(blockx * blocky);
+    // Allocate space for blocks
+    util::deallocVar(this->macroblocks);
+    this->macroblocks = util::allocVar<dc::BlockList<dc::MacroBlockSize>>(blockx * blocky);
 
-    // Get only pointers to start of each block row and save to Block in this->blocks
+    // Save a view of each block inside the buffer to Block in this->macroblocks
     for (size_t b_y = 0; b_y < blocky; b_y++) {                     ///< Block y coord
         for (size_t b_x = 0; b_x < blockx; b_x++) {                 ///< Block x coord
-            for (size_t y = 0; y < dc::MacroBlockSize; y++) {       ///< Row inside block
-                block_starts[y] = (source_block_buffer +            // Buffer start
-                                   (  (b_y * block_size * blockx)   // Block row start
-                                    + (b_x * dc::MacroBlockSize)    // Block column start
-                                    + (y * this->width)             // Row within block
-                                    + (0)));                        // Column withing block
-            }
-
-            // Create new block with the found row offsets
-            this->macroblocks->push_back(util::allocVar<dc::MacroBlock>(block_starts,
-                                                                        b_x * dc::MacroBlockSize,
-                                                                        b_y * dc::MacroBlockSize));
+            this->macroblocks->addMacroBlock(dc::BlockView { source_block_buffer, this->width,
+                                                             b_x * dc::MacroBlockSize,
+                                                             b_y * dc::MacroBlockSize });
         }
     }
 
-    // Create zig-zag-pattern LUT
-    Block<dc::BlockSize>::CreateZigZagLUT();
-
     return true;
 }
 
-dc::MacroBlock* dc::ImageProcessor::getBlockAtCoord(int16_t x, int16_t y) const {
-    uint8_t *block_starts[dc::MacroBlockSize] = { nullptr };
-
-    // Since Blocks only take pointer to their starting column for each row,
+/**
+ *  @brief  Get a view of the MacroBlock at a pixel coordinate, used as motion reference.
+ *
+ *  @param  x
+ *      The pixel column of the top-left corner.
+ *  @param  y
+ *      The pixel row of the top-left corner.
+ *  @return Returns a view inside the reader buffer, the coordinate is clamped within the frame.
+ */
+dc::BlockView dc::ImageProcessor::getViewAtCoord(int32_t x, int32_t y) const {
+    // Since views point into the frame buffer,
     // no blocks can be made outside of the boundaries.
     // This could be solved bycreating a duplicate of the reader buffer
     // but with (this->width + 2 * dc::MacroBlockSize) * (this->height + 2 * dc::MacroBlockSize)
     // in size, so referencing of coords outside of the normal frame is possible.
 
     // FIXME For now, just clamp requested coord within frame...
-    const int16_t b_x = std::clamp(x, int16_t(0), int16_t(this->width  - dc::MacroBlockSize));
-    const int16_t b_y = std::clamp(y, int16_t(0), int16_t(this->height - dc::MacroBlockSize));
-
-    for (int16_t row = 0; row < dc::MacroBlockSize; row++) {   ///< Row inside block
-        block_starts[row] = (this->reader->get_buffer() +      // Buffer start
-                           (  ((b_y + row) * this->width)      // Block row start + Row within block
-                            + (b_x)                            // Block column start
-                          ));                                  // Column withing block
-    }
+    const int32_t b_x = std::clamp(x, int32_t(0), int32_t(this->width  - dc::MacroBlockSize));
+    const int32_t b_y = std::clamp(y, int32_t(0), int32_t(this->height - dc::MacroBlockSize));
 
-    return util::allocVar<dc::MacroBlock>(block_starts, b_x, b_y);
+    return dc::BlockView { this->reader->get_buffer(), this->width, size_t(b_x), size_t(b_y) };
 }
 
-void dc::ImageProcessor::copyMacroblockToMatchingMicroblocks(dc::MacroBlock& mb) {
-    constexpr size_t mblock_size = dc::MacroBlockSize * dc::MacroBlockSize; ///< Macro px size
-    constexpr size_t  block_size = dc::BlockSize * dc::BlockSize;           ///< Micro px size
+/**
+ *  @brief  Copy the expanded motion prediction error of a MacroBlock to the
+ *          Blocks that lay within it, and encode (then decode) them.
+ *
+ *  @tparam bsize
+ *      The Block size, should divide dc::MacroBlockSize.
+ *  @param  mb
+ *      The MacroBlock with the prediction error in its expanded data.
+ *  @param  blocks
+ *      The Blocks for the entire image.
+ */
+template<size_t bsize>
+void dc::ImageProcessor::copyMacroblockToMatchingMicroblocks(dc::MacroBlock& mb, dc::BlockList<bsize>& blocks) {
+    static_assert(dc::MacroBlockSize % bsize == 0, "Block size must divide the MacroBlock size!");
 
     // For 4 micro and 16 macro size, 16 microblocks in macro, or 4x4 grid
-    constexpr size_t micro_per_macro_row = (mblock_size / block_size) / dc::BlockSize;
+    constexpr size_t micro_per_macro_row = dc::MacroBlockSize / bsize;
 
-    const size_t blockx = this->width  / dc::BlockSize;  ///< Amount of Micro on a row
+    const size_t blockx = this->width  / bsize;                           ///< Amount of Micro on a row
     const size_t   mb_x = size_t(mb.getCoord().x0) / dc::MacroBlockSize;  ///< Macro x idx
     const size_t   mb_y = size_t(mb.getCoord().y0) / dc::MacroBlockSize;  ///< Macro y idx
 
-    // Micro at (x, y) = this->blocks[y * blockx + x]
+    // Micro at (x, y) = blocks[y * blockx + x]
     // Micro in first col of Macro at (mb_x, mb_y):
-    //      this->blocks[mb_y * mblocky + mb_x]
+    //      blocks[mb_y * mblocky + mb_x]
 
     for (size_t y = 0; y < micro_per_macro_row; y++) {
         // For each row of Micros in Macro
 
-        dc::MicroBlock **row_start = this->blocks->data()                      // Buffer start
-                                      + (mb_y * blockx * micro_per_macro_row)  // Start of Micro row at Macro
-                                      + (mb_x * micro_per_macro_row)           // Start of Micro col at Macro
-                                      + (y * blockx + 0);                      // First Micro in Macro row
+        dc::Block<bsize> *row_start = &blocks[0]                               // Buffer start
+                                    + (mb_y * blockx * micro_per_macro_row)    // Start of Micro row at Macro
+                                    + (mb_x * micro_per_macro_row)             // Start of Micro col at Macro
+                                    + (y * blockx + 0);                        // First Micro in Macro row
 
         for (size_t x = 0; x < micro_per_macro_row; x++) {
             // For each Micro in Macro row
-            for (size_t row = 0; row < dc::BlockSize; row++) {
-                // Copy the correct 4x4 piece of Macro to Micro, from expanded to expanded
-                std::copy_n(mb.getExpandedRow( y * dc::BlockSize + row ) + x * dc::BlockSize,
-                            dc::BlockSize,
-                            row_start[x]->getExpandedRow(row));
+            for (size_t row = 0; row < bsize; row++) {
+                // Copy the correct piece of Macro to Micro, from expanded to expanded
+                std::copy_n(mb.getExpandedRow( y * bsize + row ) + x * bsize,
+                            bsize,
+                            row_start[x].getExpandedRow(row));
             }
 
             // Encode MicroBlock
-            row_start[x]->processDCTDivQ(this->quant_m.getData());
-            row_start[x]->createRLESequence();
+            row_start[x].processDCTDivQ(this->quant_m.getZigzagData());
+            row_start[x].createRLESequence();
 
             // Decode MicroBlock so next p-frame can use this as new diff
-            row_start[x]->processIDCTMulQ(this->quant_m.getData());
+            row_start[x].processIDCTMulQ(this->quant_m.getZigzagData());
+        }
+    }
+}
+
+template void dc::ImageProcessor::copyMacroblockToMatchingMicroblocks< 4u>(dc::MacroBlock&, dc::BlockList< 4u>&);
+template void dc::ImageProcessor::copyMacroblockToMatchingMicroblocks< 8u>(dc::MacroBlock&, dc::BlockList< 8u>&);
+template void dc::ImageProcessor::copyMacroblockToMatchingMicroblocks<16u>(dc::MacroBlock&, dc::BlockList<16u>&);
+
+/**
+ *  @brief  Create a single Block at the given pixel coordinate.
+ *
+ *  @tparam bsize
+ *      The Block size.
+ *  @param  blocks
+ *      The list to add the Block to.
+ *  @param  source_block_buffer
+ *      The source stream to create the Block from, see createBlocks().
+ *  @param  x
+ *      The pixel column of the top-left corner.
+ *  @param  y
+ *      The pixel row of the top-left corner.
+ *  @param  scale
+ *      The factor the buffer is smaller than the image, see createBlocks().
+ *  @return Returns the new Block inside blocks.
+ */
+template<size_t bsize>
+dc::Block<bsize>& dc::ImageProcessor::createBlockAt(dc::BlockList<bsize> &blocks,
+                                                    uint8_t * const source_block_buffer,
+                                                    const size_t x, const size_t y,
+                                                    const size_t scale) const
+{
+    return blocks.add(dc::BlockView { source_block_buffer, this->width / scale, x / scale, y / scale, scale });
+}
+
+template dc::Block< 4u>& dc::ImageProcessor::createBlockAt< 4u>(dc::BlockList< 4u>&, uint8_t * const, const size_t, const size_t, const size_t) const;
+template dc::Block< 8u>& dc::ImageProcessor::createBlockAt< 8u>(dc::BlockList< 8u>&, uint8_t * const, const size_t, const size_t, const size_t) const;
+template dc::Block<16u>& dc::ImageProcessor::createBlockAt<16u>(dc::BlockList<16u>&, uint8_t * const, const size_t, const size_t, const size_t) const;
+
+/**
+ *  @brief  Partition the image in MacroBlocks, and every MacroBlock in a quadtree
+ *          of 16x16, 8x8 and 4x4 Blocks.
+ *
+ *          Nodes are visited in stream order: MacroBlocks row by row, then depth-first.
+ *          A node that lies completely inside the image and is larger than 4x4
+ *          asks split_func whether to split, and stores a split flag.
+ *          Nodes crossing the image border are always split, without a flag,
+ *          so the image dimensions only need to be a multiple of 4.
+ *
+ *  @param  source_block_buffer
+ *      The source stream to create the Blocks from, see createBlocks().
+ *  @param  split_func
+ *      Decides whether a node is split (the encoder heuristic, or the flag read by the decoder).
+ *  @param  leaf_func
+ *      Called for every node that has a Block, directly after creating it.
+ *  @param  scale
+ *      The factor the buffer is smaller than the image, see createBlocks().
+ *  @return Returns the nodes and Blocks, deallocate with util::deallocVar().
+ */
+dc::AdaptiveBlocks* dc::ImageProcessor::createAdaptiveBlocks(uint8_t * const source_block_buffer,
+                                                             const SplitFunc &split_func,
+                                                             const LeafFunc &leaf_func,
+                                                             const size_t scale) const
+{
+    util::Logger::WriteLn("[ImageProcessor] Creating adaptive blocks...");
+
+    dc::AdaptiveBlocks *adaptive = util::allocVar<dc::AdaptiveBlocks>(this->width, this->height);
+
+    std::function<void(size_t, size_t, size_t)> visit = [&](size_t x, size_t y, size_t size) {
+        dc::PartitionNode node { x, y, uint8_t(size), false, false, 0u };
+
+        const bool inside = (x + size <= this->width) && (y + size <= this->height);
+
+        if (size > dc::MinBlockSize) {
+            node.has_flag = inside;
+            node.split    = inside ? split_func(node) : true;
+        }
+
+        if (!node.split) {
+            dc::dispatchBlockSize(size, [&](auto bsize) {
+                dc::BlockList<bsize> &list = adaptive->get<decltype(bsize)::value>();
+
+                node.index = list.size();
+                this->createBlockAt<decltype(bsize)::value>(list, source_block_buffer, x, y, scale);
+            });
+        }
+
+        adaptive->nodes.push_back(node);
+
+        if (node.split) {
+            const size_t half = size / 2u;
+
+            for (size_t sub = 0; sub < 4u; sub++) {
+                const size_t sub_x = x + (sub % 2u) * half;
+                const size_t sub_y = y + (sub / 2u) * half;
+
+                if (sub_x < this->width && sub_y < this->height) {
+                    visit(sub_x, sub_y, half);
+                }
+            }
+        } else {
+            leaf_func(node, *adaptive);
+        }
+    };
+
+    for (size_t y = 0; y < this->height; y += dc::MacroBlockSize) {
+        for (size_t x = 0; x < this->width; x += dc::MacroBlockSize) {
+            visit(x, y, dc::MacroBlockSize);
         }
     }
+
+    return adaptive;
+}
+
+/**
+ *  @brief  Get the quantization matrix for every Block size in zig-zag order,
+ *          for adaptive Block sizes.
+ *
+ *  @param  data
+ *      The output, [0] for 4x4, [1] for 8x8 and [2] for 16x16.
+ */
+void dc::ImageProcessor::getAdaptiveQuantData(double (&data)[3][dc::MaxBlockSize * dc::MaxBlockSize]) const {
+    this->quant_m.getResampledZigzagData( 4u, data[0]);
+    this->quant_m.getResampledZigzagData( 8u, data[1]);
+    this->quant_m.getResampledZigzagData(16u, data[2]);
+}
+
+/**
+ *  @brief  Get the length of the settings header written by writeHeader().
+ *  @return Returns the length in bits.
+ */
+size_t dc::ImageProcessor::getHeaderLength(void) const {
+    const uint8_t quant_bit_len = this->quant_m.getMaxBitLength();
+    const size_t  quant_size    = this->quant_m.getSize();
+
+    return dc::ImageProcessor::RLE_BITS         // Bit for RLE setting
+         + dc::ImageProcessor::ADAPTIVE_BITS    // Bit for adaptive Block size setting
+         + dc::ImageProcessor::getFieldsLength(2u, this->hasWideHeader())  // Image dimensions
+         + this->getBlockIndexLength()          // Block index (if enabled)
+         + this->getTileIndexLength()           // Tile index (if tiled)
+         + dc::ImageProcessor::PROGRESSIVE_BITS // Bit for progressive layout setting
+         + dc::ImageProcessor::DEDUP_BITS       // Bit for Block references setting
+         + dc::MatrixReader<>::BLOCK_SIZE_BITS  // Bits to signify size of quant_matrix (and Blocks)
+         + dc::MatrixReader<>::SIZE_LEN_BITS    // Bits to signify size of quant_matrix contents
+         + (quant_bit_len                       // Size of quantmatrix
+            * quant_size * quant_size);
+}
+
+/**
+ *  @brief  Write the settings header, in the order the decoder ctor reads it.
+ *
+ *  @param  writer
+ *      The BitStreamWriter to write the header to.
+ */
+void dc::ImageProcessor::writeHeader(util::BitStreamWriter &writer) const {
+    // Write matrix data first
+    this->quant_m.write(writer);
+
+    // Write other settings
+    writer.put(dc::ImageProcessor::RLE_BITS, uint32_t(this->use_rle));
+    writer.put(dc::ImageProcessor::ADAPTIVE_BITS, uint32_t(this->adaptive));
+    dc::ImageProcessor::writeFields(writer, { this->width, this->height }, this->hasWideHeader());
+
+    this->writeBlockIndex(writer);
+    this->writeTileIndex(writer);
+    writer.put(dc::ImageProcessor::PROGRESSIVE_BITS, uint32_t(this->progressive));
+    writer.put(dc::ImageProcessor::DEDUP_BITS, uint32_t(this->deduplicated));
+}
+
+/**
+ *  @brief  Check whether the dimension fields of a header need a wide header (see writeFields()):
+ *          a field does not fit in DIM_BITS, or the first field is 0.
+ */
+bool dc::ImageProcessor::needsWideFields(const std::vector<size_t> &fields) {
+    return (!fields.empty() && fields.front() == 0u)
+        || std::any_of(fields.begin(), fields.end(), [](const size_t field) {
+               return (field >> dc::ImageProcessor::DIM_BITS) != 0u;
+           });
+}
+
+/**
+ *  @brief  Get the length of the dimension fields written by writeFields() in bits.
+ *
+ *  @param  count
+ *      The amount of fields.
+ *  @param  wide
+ *      Whether the fields are written in a wide header.
+ */
+size_t dc::ImageProcessor::getFieldsLength(const size_t count, const bool wide) {
+    if (!wide) {
+        return count * dc::ImageProcessor::DIM_BITS;
+    }
+
+    return dc::ImageProcessor::DIM_BITS
+         + dc::ImageProcessor::HEADER_VERSION_BITS
+         + count * dc::ImageProcessor::WIDE_DIM_BITS;
+}
+
+/**
+ *  @brief  Write the dimension fields of a header (the width and height of an image,
+ *          a video also has the amount of frames, the gop and the merange).
+ *
+ *          Every field has DIM_BITS, unless the header is wide: then a 0 (never a valid width)
+ *          is written first, followed by the header version and every field with WIDE_DIM_BITS.
+ *
+ *  @param  writer
+ *      The BitStreamWriter to write the header to.
+ *  @param  fields
+ *      The values of the fields, in order.
+ *  @param  wide
+ *      Whether to write a wide header, required if needsWideFields(fields).
+ */
+void dc::ImageProcessor::writeFields(util::BitStreamWriter &writer, const std::vector<size_t> &fields, const bool wide) {
+    if (!wide) {
+        for (const size_t field : fields) {
+            writer.put(dc::ImageProcessor::DIM_BITS, uint32_t(field));
+        }
+
+        return;
+    }
+
+    writer.put(dc::ImageProcessor::DIM_BITS, 0u);
+    writer.put(dc::ImageProcessor::HEADER_VERSION_BITS, dc::ImageProcessor::WIDE_HEADER_VERSION);
+
+    for (const size_t field : fields) {
+        writer.put(dc::ImageProcessor::WIDE_DIM_BITS, uint32_t(field));
+    }
+}
+
+/**
+ *  @brief  Read the dimension fields written by writeFields(), fields must already have the amount of fields.
+ *          An unknown header version is an error (the stream was written by a newer encoder).
+ *
+ *  @return Returns whether the header is wide.
+ */
+bool dc::ImageProcessor::readFields(util::BitStreamReader &reader, std::vector<size_t> &fields) {
+    if (fields.empty()) {
+        return false;
+    }
+
+    fields[0] = reader.get(dc::ImageProcessor::DIM_BITS);
+
+    if (fields[0] != 0u) {
+        for (size_t i = 1; i < fields.size(); i++) {
+            fields[i] = reader.get(dc::ImageProcessor::DIM_BITS);
+        }
+
+        return false;
+    }
+
+    const uint32_t version = reader.get(dc::ImageProcessor::HEADER_VERSION_BITS);
+
+    if (version != dc::ImageProcessor::WIDE_HEADER_VERSION) {
+        util::Logger::WriteLn(std::string_format("[ImageProcessor] Unsupported header version %d!", version));
+        exit(-1);
+    }
+
+    for (size_t &field : fields) {
+        field = reader.get(dc::ImageProcessor::WIDE_DIM_BITS);
+    }
+
+    return true;
+}
+
+/**
+ *  @brief  Check whether the settings header of this image is wide (see writeFields()):
+ *          a dimension or the tile size does not fit in DIM_BITS,
+ *          or the block index interval does not fit in INDEX_INTERVAL_BITS.
+ *          A wide header also writes the tile size and the interval with WIDE_DIM_BITS.
+ */
+bool dc::ImageProcessor::hasWideHeader(void) const {
+    return dc::ImageProcessor::needsWideFields({ this->width, this->height, this->tile_size })
+        || (this->index_interval >> dc::ImageProcessor::INDEX_INTERVAL_BITS) != 0u;
+}
+
+/**
+ *  @brief  Get the bit length of a value, which can be longer than 32 bits.
+ */
+static uint8_t BitLength(const size_t value) {
+    return (value >> 32u) != 0u ? uint8_t(32u + util::ffs(uint32_t(value >> 32u)))
+                                : util::ffs(uint32_t(value));
+}
+
+/**
+ *  @brief  Get the bit length of every entry of an offset table: the bit length of the last (largest) offset.
+ */
+static uint8_t OffsetEntryLength(const std::vector<size_t> &offsets) {
+    return offsets.empty() ? 1u : std::max<uint8_t>(1u, BitLength(offsets.back()));
+}
+
+/**
+ *  @brief  Get the length of an offset table written by writeOffsets() in bits.
+ */
+size_t dc::ImageProcessor::getOffsetsLength(const std::vector<size_t> &offsets) {
+    return dc::ImageProcessor::INDEX_ENTRY_LEN_BITS + offsets.size() * OffsetEntryLength(offsets);
+}
+
+/**
+ *  @brief  Write an offset table: the bit length of an entry, followed by every entry.
+ *          The offsets must be ascending.
+ */
+void dc::ImageProcessor::writeOffsets(util::BitStreamWriter &writer, const std::vector<size_t> &offsets) {
+    const uint32_t entry_len = OffsetEntryLength(offsets);
+
+    writer.put(dc::ImageProcessor::INDEX_ENTRY_LEN_BITS, entry_len);
+
+    // Entries of more than 32 bits (streams of more than 512 MiB) are written in two parts
+    for (const size_t offset : offsets) {
+        if (entry_len > 32u) {
+            writer.put(entry_len - 32u, uint32_t(offset >> 32u));
+        }
+
+        writer.put(std::min<uint32_t>(entry_len, 32u), uint32_t(offset));
+    }
+}
+
+/**
+ *  @brief  Read an offset table written by writeOffsets(), offsets must already have the amount of entries.
+ */
+void dc::ImageProcessor::readOffsets(util::BitStreamReader &reader, std::vector<size_t> &offsets) {
+    const size_t entry_len = reader.get(dc::ImageProcessor::INDEX_ENTRY_LEN_BITS);
+
+    for (size_t &offset : offsets) {
+        offset = entry_len > 32u ? size_t(reader.get(entry_len - 32u)) << 32u : 0u;
+        offset |= reader.get(std::min<size_t>(entry_len, 32u));
+    }
+}
+
+/**
+ *  @brief  Get the length of the block index in the settings header.
+ *  @return Returns the length in bits, including the bit that signals whether an index is present.
+ */
+size_t dc::ImageProcessor::getBlockIndexLength(void) const {
+    if (this->index_interval == 0u) {
+        return dc::ImageProcessor::INDEX_BITS;
+    }
+
+    return dc::ImageProcessor::INDEX_BITS
+         + (this->hasWideHeader() ? dc::ImageProcessor::WIDE_DIM_BITS : dc::ImageProcessor::INDEX_INTERVAL_BITS)
+         + dc::ImageProcessor::getOffsetsLength(this->block_index);
+}
+
+/**
+ *  @brief  Write the block index to the settings header.
+ *
+ *          1. Write whether an index is present
+ *          2. Write the interval (amount of Blocks between two entries)
+ *          3. Write the bit length of an entry, which is the bit length of the last (largest) entry
+ *          4. Write the bit offset of every index_interval'th Block, relative to the start of the Block data
+ *
+ *  @param  writer
+ *      The BitStreamWriter to write the header to.
+ */
+void dc::ImageProcessor::writeBlockIndex(util::BitStreamWriter &writer) const {
+    writer.put(dc::ImageProcessor::INDEX_BITS, uint32_t(this->index_interval != 0u));
+
+    if (this->index_interval == 0u) {
+        return;
+    }
+
+    writer.put(this->hasWideHeader() ? dc::ImageProcessor::WIDE_DIM_BITS : dc::ImageProcessor::INDEX_INTERVAL_BITS,
+               uint32_t(this->index_interval));
+    dc::ImageProcessor::writeOffsets(writer, this->block_index);
+}
+
+/**
+ *  @brief  Read the block index from the settings header, see writeBlockIndex().
+ *          The amount of entries follows from the image dimensions and the Block size.
+ *
+ *  @param  reader
+ *      The BitStreamReader positioned at the block index.
+ *  @param  wide
+ *      Whether the header is wide (see readFields()), the interval then has WIDE_DIM_BITS.
+ */
+void dc::ImageProcessor::readBlockIndex(util::BitStreamReader &reader, const bool wide) {
+    this->index_interval = 0u;
+    this->block_index.clear();
+
+    if (reader.get(dc::ImageProcessor::INDEX_BITS) == 0u) {
+        return;
+    }
+
+    const size_t interval    = reader.get(wide ? dc::ImageProcessor::WIDE_DIM_BITS : dc::ImageProcessor::INDEX_INTERVAL_BITS);
+    const size_t bsize       = this->getBlockSize();
+    const size_t block_count = (this->width / bsize) * (this->height / bsize);
+
+    this->block_index.resize((interval == 0u || block_count == 0u) ? 0u : (block_count - 1u) / interval);
+    dc::ImageProcessor::readOffsets(reader, this->block_index);
+
+    this->index_interval = block_count == 0u ? 0u : interval;
+}
+
+/**
+ *  @brief  Get the amount of tiles in the image (0 if not tiled).
+ */
+size_t dc::ImageProcessor::getTileCount(void) const {
+    if (this->tile_size == 0u) {
+        return 0u;
+    }
+
+    return ((this->width  + this->tile_size - 1u) / this->tile_size)
+         * ((this->height + this->tile_size - 1u) / this->tile_size);
+}
+
+/**
+ *  @brief  Get the pixel rectangle of a tile, tiles at the right and bottom edge can be smaller.
+ *
+ *  @param  tile
+ *      The tile number, in raster order.
+ */
+dc::TileRect dc::ImageProcessor::getTileRect(const size_t tile) const {
+    const size_t tiles_x = (this->width + this->tile_size - 1u) / this->tile_size;
+    const size_t x       = (tile % tiles_x) * this->tile_size;
+    const size_t y       = (tile / tiles_x) * this->tile_size;
+
+    return dc::TileRect { x, y,
+                          std::min<size_t>(this->tile_size, this->width  - x),
+                          std::min<size_t>(this->tile_size, this->height - y) };
+}
+
+/**
+ *  @brief  Get the length of the tile index in the settings header.
+ *  @return Returns the length in bits, including the bit that signals whether the image is tiled.
+ */
+size_t dc::ImageProcessor::getTileIndexLength(void) const {
+    if (this->tile_size == 0u) {
+        return dc::ImageProcessor::TILE_BITS;
+    }
+
+    return dc::ImageProcessor::TILE_BITS
+         + (this->hasWideHeader() ? dc::ImageProcessor::WIDE_DIM_BITS : dc::ImageProcessor::DIM_BITS)
+         + dc::ImageProcessor::getOffsetsLength(this->tile_index);
+}
+
+/**
+ *  @brief  Write the tile index to the settings header.
+ *
+ *          1. Write whether the image is tiled
+ *          2. Write the tile size
+ *          3. Write the bit length of an entry, which is the bit length of the last (largest) entry
+ *          4. Write the bit offset of the first Block of every tile after the first one,
+ *             relative to the start of the Block data
+ *
+ *  @param  writer
+ *      The BitStreamWriter to write the header to.
+ */
+void dc::ImageProcessor::writeTileIndex(util::BitStreamWriter &writer) const {
+    writer.put(dc::ImageProcessor::TILE_BITS, uint32_t(this->tile_size != 0u));
+
+    if (this->tile_size == 0u) {
+        return;
+    }
+
+    writer.put(this->hasWideHeader() ? dc::ImageProcessor::WIDE_DIM_BITS : dc::ImageProcessor::DIM_BITS,
+               uint32_t(this->tile_size));
+    dc::ImageProcessor::writeOffsets(writer, this->tile_index);
+}
+
+/**
+ *  @brief  Read the tile index from the settings header, see writeTileIndex().
+ *
+ *  @param  reader
+ *      The BitStreamReader positioned at the tile index.
+ *  @param  wide
+ *      Whether the header is wide (see readFields()), the tile size then has WIDE_DIM_BITS.
+ */
+void dc::ImageProcessor::readTileIndex(util::BitStreamReader &reader, const bool wide) {
+    this->tile_size = 0u;
+    this->tile_index.clear();
+
+    if (reader.get(dc::ImageProcessor::TILE_BITS) == 0u) {
+        return;
+    }
+
+    this->tile_size = reader.get(wide ? dc::ImageProcessor::WIDE_DIM_BITS : dc::ImageProcessor::DIM_BITS);
+
+    const size_t tile_count = this->getTileCount();
+
+    this->tile_index.resize(tile_count == 0u ? 0u : tile_count - 1u);
+    dc::ImageProcessor::readOffsets(reader, this->tile_index);
+}
+
+/**
+ *  @brief  Create the output stream and write the settings header.
+ *
+ *          1. Determine header length
+ *          2. Estimate final stream length (header + data_length)
+ *          3. Write header (encoding settings)
+ *
+ *  @param  data_length
+ *      The (estimated) length of the Block data in bits.
+ */
+void dc::ImageProcessor::createHeader(const size_t data_length) {
+    util::Logger::WriteLn("[ImageProcessor] Creating settings header...");
+    size_t output_length = this->getHeaderLength();
+
+    util::Logger::WriteLn(std::string_format("[ImageProcessor] Settings header length: %.1f bytes.",
+                                             float(output_length) / 8.f));
+
+    output_length += data_length;
+    #ifndef ENABLE_HUFFMAN
+        output_length++;    // Add one bit to signal Huffman is not enabled.
+    #endif
+
+    output_length = util::round_to_byte(output_length);     // Padding to next whole byte
+
+
+    util::deallocVar(this->writer);
+    this->writer = util::allocVar<util::BitStreamWriter>(output_length, util::PLANE_UNINITIALISED);
+
+    #ifndef ENABLE_HUFFMAN
+        this->writer->put_bit(0); // '0': No Huffman sequence present.
+    #endif
+
+    this->writeHeader(*this->writer);
+}
+
+/**
+ *  @brief  Get the ranges of Blocks that start at a known bit offset in the stream:
+ *          from the block index, or else every tile (empty if there is neither).
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ */
+template<size_t bsize>
+std::vector<dc::BlockRange> dc::ImageProcessor::getBlockRanges(void) const {
+    std::vector<dc::BlockRange> ranges;
+
+    if (this->index_interval != 0u) {
+        ranges.push_back(dc::BlockRange { 0u, 0u });
+
+        for (size_t i = 0; i < this->block_index.size(); i++) {
+            ranges.push_back(dc::BlockRange { (i + 1u) * this->index_interval, this->block_index[i] });
+        }
+    } else if (this->tile_size != 0u) {
+        for (size_t t = 0, first = 0; t < this->getTileCount(); t++) {
+            const dc::TileRect tile = this->getTileRect(t);
+
+            ranges.push_back(dc::BlockRange { first, t == 0u ? 0u : this->tile_index[t - 1u] });
+            first += (tile.width / bsize) * (tile.height / bsize);
+        }
+    }
+
+    return ranges;
+}
+
+template std::vector<dc::BlockRange> dc::ImageProcessor::getBlockRanges< 4u>(void) const;
+template std::vector<dc::BlockRange> dc::ImageProcessor::getBlockRanges< 8u>(void) const;
+template std::vector<dc::BlockRange> dc::ImageProcessor::getBlockRanges<16u>(void) const;
+
+/**
+ *  @brief  Load the coefficients of every Block from the stream, in the layout of the image:
+ *          band by band for the progressive layout, every range of the block or tile index
+ *          in parallel, or else every Block in sequence (copying every referenced Block
+ *          of a deduplicated image, see ImageEncoder::streamDeduplicated()).
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  blocks
+ *      The Blocks to load.
+ */
+template<size_t bsize>
+void dc::ImageProcessor::loadBlocks(dc::BlockList<bsize> &blocks) {
+    if (this->progressive) {
+        for (size_t band = 0, begin = 0; begin < bsize * bsize; band++) {
+            const size_t end = std::min(dc::ImageProcessor::PROGRESSIVE_BANDS[band], bsize * bsize);
+
+            for (Block<bsize>& b : blocks) {
+                b.loadBand(*this->reader, begin, end);
+            }
+
+            begin = end;
+        }
+
+        return;
+    }
+
+    if (this->deduplicated) {
+        util::BitStreamReader &reader = *this->reader;
+        std::vector<size_t> unique;     // Every Block that was streamed, a reference is an index in here
+
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (reader.get_bit() == 0u) {
+                blocks[i].loadFromStream(reader, this->use_rle);
+                unique.push_back(i);
+                continue;
+            }
+
+            const size_t ref = reader.get(ImageProcessor::getReferenceLength(unique.size()));
+
+            // A corrupt reference leaves the Block empty
+            if (ref < unique.size()) {
+                blocks[i].copyCoefficientsFrom(blocks[unique[ref]]);
+            }
+        }
+
+        return;
+    }
+
+    const std::vector<dc::BlockRange> ranges = ImageProcessor::getBlockRanges<bsize>();
+
+    if (ranges.empty()) {
+        for (Block<bsize>& b : blocks) {
+            b.loadFromStream(*this->reader, this->use_rle);
+        }
+
+        return;
+    }
+
+    const size_t data_start = this->reader->get_position();
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (size_t r = 0; r < ranges.size(); r++) {
+        const size_t begin = ranges[r].first;
+        const size_t end   = (r + 1u < ranges.size()) ? ranges[r + 1u].first : blocks.size();
+
+        util::BitStreamReader reader(this->reader->get_buffer(), this->reader->get_size());
+        reader.set_position(data_start + ranges[r].offset);
+
+        for (size_t i = begin; i < end; i++) {
+            blocks[i].loadFromStream(reader, this->use_rle);
+        }
+    }
+}
+
+template void dc::ImageProcessor::loadBlocks< 4u>(dc::BlockList< 4u>&);
+template void dc::ImageProcessor::loadBlocks< 8u>(dc::BlockList< 8u>&);
+template void dc::ImageProcessor::loadBlocks<16u>(dc::BlockList<16u>&);
+
+/**
+ *  @brief  Write header (encoding settings) and stream the quantised Blocks in the layout of the settings.
+ *
+ *          1. Determine the exact stream length of every Block, see Block::streamLength()
+ *          2. Create the block and tile index from the stream lengths (if enabled)
+ *          3. Write header (encoding settings), see createHeader()
+ *          4. Stream the results to the byte stream, ignoring trailing zeroes if use_rle == true
+ *
+ *          The progressive layout is written by streamProgressive() instead.
+ *          Repeated Blocks are streamed in full, the image is no longer deduplicated.
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  blocks
+ *      The Blocks, after quantization and creating the RLE sequence.
+ */
+template<size_t bsize>
+void dc::ImageProcessor::streamBlocks(dc::BlockList<bsize> &blocks) {
+    // Every Block is streamed, references to repeated Blocks are written by ImageEncoder::streamDeduplicated() only
+    this->deduplicated = false;
+
+    if (this->progressive) {
+        this->streamProgressive(blocks);
+        return;
+    }
+
+    const size_t block_count = blocks.size();
+
+    // The exact stream lengths give the size of the Block data and the offsets for the block and tile index
+    std::vector<size_t> offsets(block_count + 1u, 0u);
+
+    for (size_t i = 0; i < block_count; i++) {
+        offsets[i + 1u] = offsets[i] + blocks[i].streamLength(this->use_rle);
+    }
+
+    this->block_index.clear();
+
+    if (this->index_interval != 0u) {
+        for (size_t i = this->index_interval; i < block_count; i += this->index_interval) {
+            this->block_index.push_back(offsets[i]);
+        }
+    }
+
+    this->tile_index.clear();
+
+    for (size_t t = 0, first = 0; t < this->getTileCount(); t++) {
+        const dc::TileRect tile = this->getTileRect(t);
+
+        if (t != 0u) {
+            this->tile_index.push_back(offsets[first]);
+        }
+
+        first += (tile.width / bsize) * (tile.height / bsize);
+    }
+
+    // Write setting header
+    this->createHeader(offsets.back());
+
+    // Writing results must happen in sequence, so every thread writes its own range
+    ImageProcessor::streamParallel(block_count, Block<bsize>::MAX_STREAM_BITS,
+                                   [&](const size_t i, util::BitStreamWriter &writer) {
+        blocks[i].streamEncoded(writer, this->use_rle);
+    });
+}
+
+template void dc::ImageProcessor::streamBlocks< 4u>(dc::BlockList< 4u>&);
+template void dc::ImageProcessor::streamBlocks< 8u>(dc::BlockList< 8u>&);
+template void dc::ImageProcessor::streamBlocks<16u>(dc::BlockList<16u>&);
+
+/**
+ *  @brief  Write header (encoding settings) and stream the Blocks in the progressive layout:
+ *          band by band (see ImageProcessor::PROGRESSIVE_BANDS), the band of every Block in turn.
+ *          A decoder can reconstruct a preview from the first bands only.
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  blocks
+ *      The Blocks, after quantization.
+ */
+template<size_t bsize>
+void dc::ImageProcessor::streamProgressive(dc::BlockList<bsize> &blocks) {
+    const size_t block_count = blocks.size();
+    const size_t band_count  = std::size(dc::ImageProcessor::PROGRESSIVE_BANDS);
+
+    // Upper estimate: a bit length for every band and 16 bits for every coefficient
+    this->createHeader(block_count * (band_count * Block<bsize>::SIZE_LEN_BITS + bsize * bsize * 16u));
+
+    for (size_t band = 0, begin = 0; begin < bsize * bsize; band++) {
+        const size_t end = std::min(dc::ImageProcessor::PROGRESSIVE_BANDS[band], bsize * bsize);
+
+        // Writing results must happen in sequence, so every thread writes its own range
+        ImageProcessor::streamParallel(block_count, Block<bsize>::MAX_BAND_BITS,
+                                       [&](const size_t i, util::BitStreamWriter &writer) {
+            blocks[i].streamBand(writer, begin, end);
+        });
+
+        util::Logger::WriteLn(std::string_format("[ImageProcessor] Band %d (coefficients %d to %d) ends at %.1f bytes.",
+                                                 band, begin, end - 1u, float(this->writer->get_position()) / 8.f));
+        begin = end;
+    }
+}
+
+template void dc::ImageProcessor::streamProgressive< 4u>(dc::BlockList< 4u>&);
+template void dc::ImageProcessor::streamProgressive< 8u>(dc::BlockList< 8u>&);
+template void dc::ImageProcessor::streamProgressive<16u>(dc::BlockList<16u>&);
+
+/**
+ *  @brief  Write header (encoding settings) and stream every split flag and Block
+ *          of an adaptive partition in partition order.
+ *
+ *  @param  adaptive
+ *      The nodes and Blocks, after quantization and creating the RLE sequences.
+ */
+void dc::ImageProcessor::streamAdaptive(dc::AdaptiveBlocks &adaptive) {
+    // Upper estimate: a flag for every node, plus the bit length and 16 bits for every pixel for every Block
+    this->createHeader(adaptive.nodes.size() * (1u + dc::Block<>::SIZE_LEN_BITS)
+                     + size_t(this->width) * this->height * 16u);
+
+    // Writing results must happen in sequence, so every thread writes its own range of nodes
+    ImageProcessor::streamParallel(adaptive.nodes.size(), 1u + dc::Block<dc::MaxBlockSize>::MAX_STREAM_BITS,
+                                   [&](const size_t i, util::BitStreamWriter &writer) {
+        const dc::PartitionNode &node = adaptive.nodes[i];
+
+        if (node.has_flag) {
+            writer.put_bit(node.split);
+        }
+
+        if (!node.split) {
+            dc::dispatchBlockSize(node.size, [&](auto bsize) {
+                adaptive.get<decltype(bsize)::value>()[node.index].streamEncoded(writer, this->use_rle);
+            });
+        }
+    });
+}
+
+/**
+ *  @brief  Apply Huffman encoding on the written stream (if enabled),
+ *          the stream is kept if Huffman encoding does not make it smaller.
+ */
+void dc::ImageProcessor::compressStream(void) {
+    #ifdef ENABLE_HUFFMAN
+        util::BitStreamReader hm_input(this->writer->get_buffer(),
+                                       this->writer->get_last_byte_position());
+
+        algo::Huffman<> hm;
+        util::BitStreamWriter *hm_output = hm.encode(hm_input);
+
+        #ifdef LOG_LOCAL
+            util::Logger::WriteLn("\n", false);
+            hm.printDict();
+//            util::Logger::WriteLn("\n", false);
+//            hm.printTree();
+            util::Logger::WriteLn("\n", false);
+        #endif
+
+        if (hm_output != nullptr) {
+            util::deallocVar(this->writer);
+            this->writer = hm_output;
+        }
+
+        util::Logger::WriteLn("", false);
+    #endif
 }
 
 /**
@@ -327,10 +1234,10 @@ void dc::ImageProcessor::saveResult(bool encoded) const {
         util::write(file, *this->writer);
     #endif
 
-    util::Logger::WriteLn(std::string_format("[ImageProcessor] Original file size: %8d bytes", this->raw->size()));
+    util::Logger::WriteLn(std::string_format("[ImageProcessor] Original file size: %8d bytes", this->raw_size));
     util::Logger::WriteLn(std::string_format("[ImageProcessor]       %scoded size: %8d bytes  => Ratio: %.2f%%",
                                              (encoded ? "En" : "De"),
                                              total_length,
-                                             (float(total_length) / this->raw->size() * 100)));
+                                             (float(total_length) / this->raw_size * 100)));
     util::Logger::WriteLn("[ImageProcessor] Saved file at: " + this->dest_file);
 }
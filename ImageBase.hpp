@@ -3,12 +3,81 @@
 
 #include <string>
 #include <vector>
+#include <tuple>
+#include <functional>
 
 #include "BitStream.hpp"
 #include "Block.hpp"
 #include "MatrixReader.hpp"
 
+#ifdef ENABLE_OPENMP
+    #include <omp.h>
+#endif
+
 namespace dc {
+    /**
+     *  @brief  A list of Blocks for the Block size used by an image.
+     */
+    template<size_t bsize>
+    using BlockList = dc::BlockPlane<bsize>;
+
+    /**
+     *  @brief  A node in the adaptive Block partition of a MacroBlock (quadtree),
+     *          stored in stream order.
+     */
+    struct PartitionNode {
+        size_t  x;          ///< Pixel column of the top-left corner.
+        size_t  y;          ///< Pixel row of the top-left corner.
+        uint8_t size;       ///< 16, 8 or 4.
+        bool    has_flag;   ///< Whether a split flag is stored for this node.
+        bool    split;      ///< Whether the node is split into 4 nodes of half the size.
+        size_t  index;      ///< Index in the BlockList for its size (if not split).
+    };
+
+    /**
+     *  @brief  The pixel rectangle of a tile (or a region) of an image.
+     */
+    struct TileRect {
+        size_t x;           ///< Pixel column of the top-left corner.
+        size_t y;           ///< Pixel row of the top-left corner.
+        size_t width;       ///< Width in pixels.
+        size_t height;      ///< Height in pixels.
+    };
+
+    /**
+     *  @brief  A range of Blocks in the stream that starts at a known bit offset (see the block and tile index).
+     */
+    struct BlockRange {
+        size_t first;       ///< The first Block of the range.
+        size_t offset;      ///< Bit offset of the first Block, relative to the start of the Block data.
+    };
+
+    /**
+     *  @brief  The Blocks of an image with adaptive Block sizes,
+     *          one BlockList for every supported size.
+     */
+    struct AdaptiveBlocks {
+        std::vector<dc::PartitionNode> nodes;
+        std::tuple<dc::BlockList<4u>, dc::BlockList<8u>, dc::BlockList<16u>> lists;
+
+        /**
+         *  @brief  Every list gets room for as many Blocks of its size as fit in the image,
+         *          coefficient memory that is never used is never touched.
+         */
+        AdaptiveBlocks(const size_t width, const size_t height)
+            : lists{ (width /  4u) * (height /  4u),
+                     (width /  8u) * (height /  8u),
+                     (width / 16u) * (height / 16u) }
+        {
+            // Empty
+        }
+
+        template<size_t bsize>
+        inline dc::BlockList<bsize>& get(void) {
+            return std::get<dc::BlockList<bsize>>(this->lists);
+        }
+    };
+
     /**
      *  @brief  The ImageBase class
      *          Provides a base with the image dimensions and the raw byte buffer
@@ -16,14 +85,16 @@ namespace dc {
      */
     class ImageBase {
         protected:
-            uint16_t width;                 ///< The width of the image.
-            uint16_t height;                ///< The height of the image.
+            uint32_t width;                 ///< The width of the image.
+            uint32_t height;                ///< The height of the image.
 
-            std::vector<uint8_t>  *raw;     ///< The raw input stream.
+            uint8_t               *raw;     ///< The raw input stream (a plane, see util::allocPlane()).
+            size_t                 raw_size;  ///< The length of the raw input stream in bytes.
             util::BitStreamReader *reader;  ///< A BitStreamReader linked to the raw input stream.
         public:
-            ImageBase(const std::string &source_file, const uint16_t &width, const uint16_t &height);
-            ImageBase(uint8_t * const raw, const uint16_t &width, const uint16_t &height);
+            ImageBase(const std::string &source_file, const uint32_t &width, const uint32_t &height);
+            ImageBase(uint8_t * const raw, const uint32_t &width, const uint32_t &height);
+            ImageBase(uint8_t * const data, const size_t length);
             ~ImageBase(void);
     };
 
@@ -35,46 +106,220 @@ namespace dc {
     class ImageProcessor : protected ImageBase {
         protected:
             bool use_rle;                   ///< Whether to use Run Length Encoding.
-            MatrixReader<> quant_m;         ///< A quantization matrix instance.
+            bool adaptive;                  ///< Whether every MacroBlock selects its own Block size(s).
+            bool progressive;               ///< Whether the coefficients are stored in bands over all Blocks (see PROGRESSIVE_BANDS).
+            bool deduplicated;              ///< Whether a repeated Block is stored as a reference to the first Block with the same pixels.
+            MatrixReader<> quant_m;         ///< A quantization matrix instance, its size is the Block size.
+
+            size_t index_interval;          ///< The amount of Blocks between two entries of the block index (0: no index).
+            std::vector<size_t> block_index;  ///< Bit offset of Block (i + 1) * index_interval, relative to the start of the Block data.
+
+            size_t tile_size;               ///< The width and height of a tile in pixels (0: not tiled).
+            std::vector<size_t> tile_index;   ///< Bit offset of the first Block of tile (i + 1), relative to the start of the Block data.
 
             const std::string &dest_file;   ///< The path to the destination file.
 
-            std::vector<dc::MicroBlock*> *blocks;       ///< A list of every Block for the image.
-            std::vector<dc::MacroBlock*> *macroblocks;  ///< A list of every MacroBlock for the image.
+            dc::BlockList<dc::MacroBlockSize> *macroblocks;  ///< A list of every MacroBlock for the image.
 
             util::BitStreamWriter *writer;  ///< The output stream.
 
             void saveResult(bool) const;
-            bool process(uint8_t * const);
+
+            template<size_t bsize>
+            dc::BlockList<bsize>* createBlocks(uint8_t * const, const size_t, const size_t scale = 1u) const;
+
+            /**
+             *  @brief  Create the Blocks for the entire image, see createBlocks(buffer, rows).
+             */
+            template<size_t bsize>
+            inline dc::BlockList<bsize>* createBlocks(uint8_t * const source_block_buffer) const {
+                return this->createBlocks<bsize>(source_block_buffer, this->height);
+            }
             bool processMacroBlocks(uint8_t * const);
 
-            void copyMacroblockToMatchingMicroblocks(MacroBlock&);
+            template<size_t bsize>
+            void copyMacroblockToMatchingMicroblocks(MacroBlock&, dc::BlockList<bsize>&);
+
+            using SplitFunc = std::function<bool(const dc::PartitionNode&)>;
+            using LeafFunc  = std::function<void(const dc::PartitionNode&, dc::AdaptiveBlocks&)>;
+
+            template<size_t bsize>
+            dc::Block<bsize>& createBlockAt(dc::BlockList<bsize>&, uint8_t * const, const size_t, const size_t,
+                                            const size_t scale = 1u) const;
+            dc::AdaptiveBlocks* createAdaptiveBlocks(uint8_t * const, const SplitFunc&, const LeafFunc&,
+                                                     const size_t scale = 1u) const;
+            void getAdaptiveQuantData(double (&data)[3][dc::MaxBlockSize * dc::MaxBlockSize]) const;
+
+            size_t getHeaderLength(void) const;
+            void writeHeader(util::BitStreamWriter&) const;
+            void readHeader(void);
+            void createHeader(const size_t data_length);
+
+            bool hasWideHeader(void) const;
+
+            size_t getBlockIndexLength(void) const;
+            void writeBlockIndex(util::BitStreamWriter&) const;
+            void readBlockIndex(util::BitStreamReader&, const bool);
+
+            size_t getTileCount(void) const;
+            dc::TileRect getTileRect(const size_t) const;
+            size_t getTileIndexLength(void) const;
+            void writeTileIndex(util::BitStreamWriter&) const;
+            void readTileIndex(util::BitStreamReader&, const bool);
+
+            template<class F>
+            void streamParallel(const size_t count, const size_t max_item_bits, F &&put_item);
+
+            template<size_t bsize>
+            std::vector<dc::BlockRange> getBlockRanges(void) const;
+            template<size_t bsize>
+            void loadBlocks(dc::BlockList<bsize>&);
+            template<size_t bsize>
+            void streamBlocks(dc::BlockList<bsize>&);
+            template<size_t bsize>
+            void streamProgressive(dc::BlockList<bsize>&);
+            void streamAdaptive(dc::AdaptiveBlocks&);
+            void compressStream(void);
 
         public:
             ImageProcessor(const std::string &source_file, const std::string &dest_file,
-                           const uint16_t &width, const uint16_t &height,
+                           const uint32_t &width, const uint32_t &height,
                            const bool &use_rle, MatrixReader<> &quant_m);
             ImageProcessor(const std::string &source_file, const std::string &dest_file);
+            ImageProcessor(uint8_t * const data, const size_t length, const std::string &dest_file);
+            ImageProcessor(const std::string &dest_file,
+                           const uint32_t &width, const uint32_t &height,
+                           const bool &use_rle, MatrixReader<> &quant_m);
 
             ImageProcessor(uint8_t * const raw,
-                           const uint16_t &width, const uint16_t &height,
+                           const uint32_t &width, const uint32_t &height,
                            const bool &use_rle, MatrixReader<> &quant_m);
 
             virtual ~ImageProcessor(void);
 
             /**
              *  @brief  Process the image, needs to be implemented in a child class.
-             *          A child class can call ImageProcessor::process(buffer) to create
-             *          block from the buffer.
+             *          A child class can call ImageProcessor::createBlocks<bsize>(buffer)
+             *          to create blocks from the buffer.
              */
             virtual bool process(void)=0;
             virtual void saveResult(void) const {}
 
-            dc::MacroBlock* getBlockAtCoord(int16_t, int16_t) const;
+            dc::BlockView getViewAtCoord(int32_t, int32_t) const;
+
+            /**
+             *  @brief  Get the bit length of a reference to one of the unique Blocks before it
+             *          (0 bits if there is only one), see ImageEncoder::streamDeduplicated().
+             */
+            static inline size_t getReferenceLength(const size_t unique_count) {
+                return unique_count > 1u ? util::ffs(uint32_t(unique_count - 1u)) : 0u;
+            }
+
+            static bool needsWideFields(const std::vector<size_t>&);
+            static size_t getFieldsLength(const size_t, const bool);
+            static void writeFields(util::BitStreamWriter&, const std::vector<size_t>&, const bool);
+            static bool readFields(util::BitStreamReader&, std::vector<size_t>&);
+
+            static size_t getOffsetsLength(const std::vector<size_t>&);
+            static void writeOffsets(util::BitStreamWriter&, const std::vector<size_t>&);
+            static void readOffsets(util::BitStreamReader&, std::vector<size_t>&);
+
+            /**
+             *  @brief  Get the Block size used for this image.
+             */
+            inline size_t getBlockSize(void) const {
+                return this->quant_m.getSize();
+            }
 
             static constexpr size_t RLE_BITS = 1u;   ///< The amount of bits to use to represent zhether to use RLE or not.
+            static constexpr size_t ADAPTIVE_BITS = 1u;  ///< The amount of bits to use to represent whether adaptive Block sizes are used.
             static constexpr size_t DIM_BITS = 15u;  ///< The amount of bits to use to represent the image dimensions (width or height).
+            static constexpr size_t WIDE_DIM_BITS = 32u;  ///< The amount of bits to use to represent the dimensions in a wide header (see writeFields()).
+            static constexpr size_t HEADER_VERSION_BITS = 4u;  ///< The amount of bits to use to represent the header version of a wide header.
+            static constexpr uint32_t WIDE_HEADER_VERSION = 1u;  ///< The header version with WIDE_DIM_BITS dimensions.
+            static constexpr size_t INDEX_BITS = 1u;  ///< The amount of bits to use to represent whether a block index is present.
+            static constexpr size_t INDEX_INTERVAL_BITS = 16u;  ///< The amount of bits to use to represent the block index interval.
+            static constexpr size_t INDEX_ENTRY_LEN_BITS = 6u;  ///< The amount of bits to use to represent the bit length of every block index entry.
+            static constexpr size_t TILE_BITS = 1u;  ///< The amount of bits to use to represent whether the image is tiled.
+            static constexpr size_t PROGRESSIVE_BITS = 1u;  ///< The amount of bits to use to represent whether the progressive layout is used.
+            static constexpr size_t DEDUP_BITS = 1u;  ///< The amount of bits to use to represent whether repeated Blocks are stored as references.
+
+            /**
+             *  @brief  The zig-zag position after every band of the progressive layout, limited to the Block size:
+             *          the DC coefficients of every Block come first, then every band of AC coefficients in turn.
+             */
+            static constexpr size_t PROGRESSIVE_BANDS[] = { 1u, 6u, 15u, 36u, 136u, 256u };
     };
+
+    /**
+     *  @brief  Write count items to this->writer in order, like calling put_item(i, *this->writer)
+     *          for every i in sequence.
+     *
+     *          With OpenMP every thread writes a contiguous range of items to its own BitStreamWriter.
+     *          The exclusive prefix sum of their lengths gives the offset of every piece,
+     *          so they can be spliced into this->writer in parallel; only the bytes shared
+     *          by two pieces are written in sequence. The result is bit-identical.
+     *
+     *  @param  count
+     *      The amount of items.
+     *  @param  max_item_bits
+     *      An upper bound for the bits written by a single item (only used to size the pieces with OpenMP).
+     *  @param  put_item
+     *      Called as put_item(size_t i, util::BitStreamWriter &writer) to write item i.
+     */
+    template<class F>
+    void ImageProcessor::streamParallel(const size_t count, [[maybe_unused]] const size_t max_item_bits, F &&put_item) {
+        #ifdef ENABLE_OPENMP
+            std::vector<util::BitStreamWriter*> pieces(size_t(omp_get_max_threads()), nullptr);
+            std::vector<size_t> offsets(pieces.size() + 1u, 0u);
+            util::BitStreamWriter &writer = *this->writer;
+
+            #pragma omp parallel num_threads(int(pieces.size()))
+            {
+                const size_t threads = size_t(omp_get_num_threads());
+                const size_t t       = size_t(omp_get_thread_num());
+                const size_t begin   = (count * t) / threads;
+                const size_t end     = (count * (t + 1u)) / threads;
+
+                util::BitStreamWriter *piece = util::allocVar<util::BitStreamWriter>(
+                                                   util::round_to_byte((end - begin) * max_item_bits) + 1u,
+                                                   util::PLANE_UNINITIALISED);
+
+                for (size_t i = begin; i < end; i++) {
+                    put_item(i, *piece);
+                }
+
+                pieces[t] = piece;
+
+                #pragma omp barrier
+                #pragma omp single
+                {
+                    // Exclusive prefix sum of the piece lengths
+                    offsets[0] = writer.get_position();
+
+                    for (size_t p = 0; p < threads; p++) {
+                        offsets[p + 1u] = offsets[p] + pieces[p]->get_position();
+                    }
+
+                    offsets.resize(threads + 1u);
+                }
+
+                writer.splice(offsets[t], *piece);
+            }
+
+            // Bytes shared by two pieces are written in order
+            for (size_t p = 0; p + 1u < offsets.size(); p++) {
+                writer.splice_edges(offsets[p], *pieces[p]);
+                util::deallocVar(pieces[p]);
+            }
+
+            writer.set_position(offsets.back());
+        #else
+            for (size_t i = 0; i < count; i++) {
+                put_item(i, *this->writer);
+            }
+        #endif
+    }
 }
 
 #endif // IMAGEBASE_HPP
@@ -3,6 +3,8 @@
 #include "Logger.hpp"
 
 #include <cassert>
+#include <algorithm>
+#include <cstring>
 
 /**
  *  @brief  Default ctor
@@ -14,24 +16,60 @@
  */
 dc::ImageDecoder::ImageDecoder(const std::string &source_file, const std::string &dest_file)
     : ImageProcessor(source_file, dest_file)
+    , scale(1u)
 {
     // Decoding info like (this->quant_m, this->use_rle, width, height)
     // is gathered in the ImageProcessor ctor after Huffman decompress.
+    this->verifySettings();
+}
+
+/**
+ *  @brief  Ctor for an encoded stream in memory (e.g. a level of a pyramid, see PyramidDecoder).
+ *
+ *  @param  data
+ *      Pointer to the first byte of the encoded stream, it is not owned and must outlive the decoder.
+ *  @param  length
+ *      The length of the encoded stream in bytes.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ */
+dc::ImageDecoder::ImageDecoder(uint8_t * const data, const size_t length, const std::string &dest_file)
+    : ImageProcessor(data, length, dest_file)
+    , scale(1u)
+{
+    this->verifySettings();
+}
 
+/**
+ *  @brief  Verify the settings read from the stream and log them.
+ */
+void dc::ImageDecoder::verifySettings(void) const {
     // Verify settings
-    assert(this->width  % dc::BlockSize == 0);
-    assert(this->height % dc::BlockSize == 0);
+    assert(dc::isSupportedBlockSize(this->getBlockSize()));
+    assert(this->width  % this->getBlockSize() == 0);
+    assert(this->height % this->getBlockSize() == 0);
 
     // Same data stats before decoding starts
     const float hdrlen = float(this->reader->get_position()) / 8.0f;
     const float datlen = float(this->reader->get_size()) - hdrlen;
 
-    util::Logger::WriteLn(std::string_format("[ImageDecoder] Loaded %dx%d image with "
+    util::Logger::WriteLn(std::string_format("[ImageDecoder] Loaded %dx%d image (%s blocks) with "
                                              "%.1f bytes header and %.1f bytes data.",
-                                             this->width, this->height, hdrlen, datlen));
+                                             this->width, this->height,
+                                             this->adaptive
+                                                ? "adaptive"
+                                                : std::string_format("%dx%d", this->getBlockSize(), this->getBlockSize()).c_str(),
+                                             hdrlen, datlen));
+
+    if (this->index_interval != 0u) {
+        util::Logger::WriteLn(std::string_format("[ImageDecoder] Block index with an entry every %d Blocks.",
+                                                 this->index_interval));
+    }
 
-    // Create the output buffer
-    this->writer = util::allocVar<util::BitStreamWriter>(this->width * this->height);
+    if (this->tile_size != 0u) {
+        util::Logger::WriteLn(std::string_format("[ImageDecoder] %d tiles of %dx%d pixels.",
+                                                 this->getTileCount(), this->tile_size, this->tile_size));
+    }
 }
 
 /**
@@ -44,11 +82,8 @@ dc::ImageDecoder::~ImageDecoder(void) {
 /**
  *  @brief  Process the image for decoding.
  *
- *          1. Create Blocks
- *      For each Block:
- *          2. Load the encoded Block data from the stream
- *          3. Perform iDCT and multiply with trhe quant_matrix
- *          4. Expand the results to the byte stream
+ *          Select the Block size from the quantization matrix in the stream
+ *          and call processBlocks() for that size (or processAdaptive()).
  *
  *  @return Returns true on success.
  */
@@ -57,45 +92,93 @@ bool dc::ImageDecoder::process(void) {
 
     util::Logger::WriteLn("[ImageDecoder] Processing image...");
 
-    success = ImageProcessor::process(this->writer->get_buffer());
+    // Create the output buffer, zeroed for pixels that are not covered by a Block
+    util::deallocVar(this->writer);
+    this->writer = util::allocVar<util::BitStreamWriter>((this->width / this->scale) * (this->height / this->scale),
+                                                         util::PLANE_ZEROED | util::PLANE_HUGE_PAGES);
+
+    if (this->adaptive) {
+        success = this->processAdaptive();
+    } else {
+        success = dc::dispatchBlockSize(this->getBlockSize(), [this](auto bsize) {
+            return this->processBlocks<decltype(bsize)::value>();
+        });
+    }
+
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[ImageDecoder] Unsupported block size %d!",
+                                                 this->getBlockSize()));
+        return false;
+    }
 
-    const size_t block_count = this->blocks->size();
+    // Buffer is written implicitly
+    this->writer->set_position(this->writer->get_size_bits());
+
+    return success;
+}
+
+/**
+ *  @brief  Process the image for decoding with (bsize*bsize) Blocks.
+ *
+ *          1. Create Blocks
+ *      For each Block (for each range of Blocks in parallel, if the stream has a block or tile index):
+ *          2. Load the encoded Block data from the stream
+ *          3. Perform iDCT and multiply with trhe quant_matrix
+ *          4. Expand the results to the byte stream
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @return Returns true on success.
+ */
+template<size_t bsize>
+bool dc::ImageDecoder::processBlocks(void) {
+    dc::BlockList<bsize> *blocks = ImageProcessor::createBlocks<bsize>(this->writer->get_buffer(),
+                                                                        this->height, this->scale);
+
+    const size_t block_count = blocks->size();
     size_t blockid = 0u;
 
     util::Logger::WriteLn("[ImageDecoder] Processing Blocks...");
     util::Logger::WriteProgress(0, block_count);
 
     #ifdef LOG_LOCAL
-        for (Block<>* b : *this->blocks) {
+        for (Block<bsize>& b : *blocks) {
             util::Logger::WriteLn(std::string_format("Block % 3d:", blockid++));
 
-            b->loadFromStream(*this->reader, this->use_rle);
-            b->printExpanded();
+            b.loadFromStream(*this->reader, this->use_rle);
+            b.printExpanded();
             util::Logger::WriteLn("", false);
 
             util::Logger::WriteLn("Reverse DCT and de-quantization:");
-            b->processIDCTMulQ(this->quant_m.getData());
-            b->printExpanded();
+            b.processIDCTMulQ(this->quant_m.getZigzagData());
+            b.printExpanded();
             util::Logger::WriteLn("", false);
 
             util::Logger::WriteLn("Expanded:");
-            b->expand();
-            b->printMatrix();
+            b.expand();
+            b.printMatrix();
             util::Logger::WriteLn("", false);
             util::Logger::WriteLn("", false);
         }
     #else
+        // Ranges of Blocks that start at a known bit offset: from the block index, or else every tile
+        const std::vector<dc::BlockRange> ranges = ImageProcessor::getBlockRanges<bsize>();
+
+        if (this->progressive || this->deduplicated) {
+            this->processLoaded(*blocks);
+        } else if (!ranges.empty()) {
+            this->processRanges(*blocks, ranges);
+        } else {
         #ifdef ENABLE_OPENMP
             // Reading raw must happen in sequence
-            for (Block<>* b : *this->blocks) {
-                b->loadFromStream(*this->reader, this->use_rle);
+            for (Block<bsize>& b : *blocks) {
+                b.loadFromStream(*this->reader, this->use_rle);
             }
 
             #pragma omp parallel for shared(blockid) schedule(dynamic)
-            for (auto it = this->blocks->begin(); it < this->blocks->end(); it++) {
-                Block<> *b = *it;
-                b->processIDCTMulQ(this->quant_m.getData());
-                b->expand();
+            for (auto it = blocks->begin(); it < blocks->end(); it++) {
+                Block<bsize> &b = *it;
+                this->reconstructBlock(b, this->quant_m.getZigzagData());
 
                 #pragma omp atomic
                 ++blockid;
@@ -104,23 +187,309 @@ bool dc::ImageDecoder::process(void) {
                 util::Logger::WriteProgress(blockid, block_count);
             }
         #else
-            for (Block<>* b : *this->blocks) {
-                b->loadFromStream(*this->reader, this->use_rle);
-                b->processIDCTMulQ(this->quant_m.getData());
-                b->expand();
+            for (Block<bsize>& b : *blocks) {
+                b.loadFromStream(*this->reader, this->use_rle);
+                this->reconstructBlock(b, this->quant_m.getZigzagData());
                 util::Logger::WriteProgress(++blockid, block_count);
             }
         #endif
+        }
     #endif
 
     util::Logger::WriteLn("", false);
 
-    // Buffer is written implicitly
-    this->writer->set_position(this->writer->get_size_bits());
+    util::deallocVar(blocks);
+
+    return true;
+}
+
+/**
+ *  @brief  Load every Block first, then transform and expand the Blocks in parallel.
+ *          Used for layouts that can only be read as a whole (see ImageProcessor::loadBlocks()):
+ *          the bands of the progressive layout (see ImageProcessor::PROGRESSIVE_BANDS),
+ *          where a truncated stream reads as zeroes, so the missing bands leave out detail only,
+ *          and a deduplicated image, where a Block can be a reference to any Block before it.
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  blocks
+ *      The Blocks to process.
+ */
+template<size_t bsize>
+void dc::ImageDecoder::processLoaded(dc::BlockList<bsize> &blocks) {
+    const size_t block_count = blocks.size();
+    size_t blockid = 0u;
+
+    // Reading raw must happen in sequence
+    ImageProcessor::loadBlocks(blocks);
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for shared(blockid) schedule(dynamic)
+    #endif
+    for (auto it = blocks.begin(); it < blocks.end(); it++) {
+        Block<bsize> &b = *it;
+        this->reconstructBlock(b, this->quant_m.getZigzagData());
+
+        #ifdef ENABLE_OPENMP
+            #pragma omp atomic
+        #endif
+        ++blockid;
+
+        #ifdef ENABLE_OPENMP
+            #pragma omp critical
+        #endif
+        util::Logger::WriteProgress(blockid, block_count);
+    }
+}
+
+/**
+ *  @brief  Load, transform and expand ranges of Blocks in parallel.
+ *          Every range has its own reader, positioned at the bit offset of its first Block.
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  blocks
+ *      The Blocks to process, a range ends at the first Block of the next range.
+ *  @param  ranges
+ *      The first Block and its bit offset relative to the start of the Block data, for every range.
+ */
+template<size_t bsize>
+void dc::ImageDecoder::processRanges(dc::BlockList<bsize> &blocks, const std::vector<dc::BlockRange> &ranges) {
+    const size_t data_start  = this->reader->get_position();
+    const size_t block_count = blocks.size();
+    size_t blockid = 0u;
+
+    util::Logger::WriteProgress(0, block_count);
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for shared(blockid) schedule(dynamic)
+    #endif
+    for (size_t r = 0; r < ranges.size(); r++) {
+        const size_t begin = ranges[r].first;
+        const size_t end   = (r + 1u < ranges.size()) ? ranges[r + 1u].first : block_count;
+
+        util::BitStreamReader reader(this->reader->get_buffer(), this->reader->get_size());
+        reader.set_position(data_start + ranges[r].offset);
+
+        for (size_t i = begin; i < end; i++) {
+            Block<bsize> &b = blocks[i];
+            b.loadFromStream(reader, this->use_rle);
+            this->reconstructBlock(b, this->quant_m.getZigzagData());
+        }
+
+        #ifdef ENABLE_OPENMP
+            #pragma omp atomic
+        #endif
+        blockid += end - begin;
+
+        #ifdef ENABLE_OPENMP
+            #pragma omp critical
+        #endif
+        util::Logger::WriteProgress(blockid, block_count);
+    }
+}
+
+/**
+ *  @brief  Decode only the given region of the image, the result is a (region.width*region.height) image.
+ *
+ *          For a tiled image only the tiles that intersect the region are loaded and decoded,
+ *          other images are decoded entirely first (see process()).
+ *
+ *  @param  region
+ *      The pixel rectangle to decode, inside the image.
+ *  @return Returns true on success.
+ */
+bool dc::ImageDecoder::processRegion(const dc::TileRect &region) {
+    if (region.width == 0u || region.height == 0u
+        || region.x + region.width > this->width || region.y + region.height > this->height)
+    {
+        util::Logger::WriteLn(std::string_format("[ImageDecoder] Region %dx%d at (%d, %d) is not inside the image!",
+                                                 region.width, region.height, region.x, region.y));
+        return false;
+    }
+
+    util::Logger::WriteLn(std::string_format("[ImageDecoder] Processing region %dx%d at (%d, %d)...",
+                                             region.width, region.height, region.x, region.y));
+
+    if (this->tile_size == 0u) {
+        util::Logger::WriteLn("[ImageDecoder] Image is not tiled, decoding entire image.");
+
+        if (!this->process()) {
+            return false;
+        }
+
+        this->cropResult(this->writer->get_buffer(), dc::TileRect { 0u, 0u, this->width, this->height }, region);
+        return true;
+    }
+
+    return dc::dispatchBlockSize(this->getBlockSize(), [&](auto bsize) {
+        return this->processTiles<decltype(bsize)::value>(region);
+    });
+}
+
+/**
+ *  @brief  Decode the image at a reduced resolution, the result is a (width/scale*height/scale) image.
+ *          Every Block only transforms its lowest frequencies with a smaller iDCT
+ *          (see Block::expandScaled()), so e.g. 4x4 Blocks at 1/4 only use the DC coefficient.
+ *
+ *  @param  scale
+ *      The factor to reduce the width and height with, 2 or 4.
+ *  @return Returns true on success.
+ */
+bool dc::ImageDecoder::processScaled(const size_t scale) {
+    if (scale != 1u && scale != 2u && scale != 4u) {
+        util::Logger::WriteLn(std::string_format("[ImageDecoder] Unsupported scale 1/%d, use 1/2 or 1/4!", scale));
+        return false;
+    }
+
+    util::Logger::WriteLn(std::string_format("[ImageDecoder] Decoding at 1/%d scale (%dx%d)...",
+                                             scale, this->width / scale, this->height / scale));
+
+    this->scale = scale;
+    const bool success = this->process();
+    this->scale = 1u;
 
     return success;
 }
 
+/**
+ *  @brief  Decode the tiles that intersect the given region, see processRegion().
+ *
+ *          1. Create the Blocks of every intersecting tile, in a buffer for the bounding box of those tiles
+ *          2. Load, transform and expand every tile in parallel, starting at its offset in the tile index
+ *          3. Copy the region to the output stream
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  region
+ *      The pixel rectangle to decode, inside the image.
+ *  @return Returns true on success.
+ */
+template<size_t bsize>
+bool dc::ImageDecoder::processTiles(const dc::TileRect &region) {
+    const size_t size    = this->tile_size;
+    const size_t tiles_x = (this->width + size - 1u) / size;
+    const size_t tx0     = region.x / size, tx1 = (region.x + region.width  - 1u) / size;
+    const size_t ty0     = region.y / size, ty1 = (region.y + region.height - 1u) / size;
+
+    const dc::TileRect box { tx0 * size, ty0 * size,
+                             std::min<size_t>((tx1 + 1u) * size, this->width)  - tx0 * size,
+                             std::min<size_t>((ty1 + 1u) * size, this->height) - ty0 * size };
+
+    // Every pixel of the box is covered by a Block
+    uint8_t *pixels = util::allocPlane<uint8_t>(box.width * box.height, util::PLANE_UNINITIALISED);
+    dc::BlockList<bsize> *blocks = util::allocVar<dc::BlockList<bsize>>((box.width / bsize) * (box.height / bsize));
+    std::vector<dc::BlockRange> ranges;
+
+    for (size_t ty = ty0; ty <= ty1; ty++) {
+        for (size_t tx = tx0; tx <= tx1; tx++) {
+            const size_t       t    = ty * tiles_x + tx;
+            const dc::TileRect tile = this->getTileRect(t);
+
+            ranges.push_back(dc::BlockRange { blocks->size(), t == 0u ? 0u : this->tile_index[t - 1u] });
+
+            for (size_t y = tile.y; y < tile.y + tile.height; y += bsize) {
+                for (size_t x = tile.x; x < tile.x + tile.width; x += bsize) {
+                    blocks->add(dc::BlockView { pixels, box.width, x - box.x, y - box.y });
+                }
+            }
+        }
+    }
+
+    util::Logger::WriteLn(std::string_format("[ImageDecoder] Decoding %d of %d tiles (%d Blocks)...",
+                                             ranges.size(), this->getTileCount(), blocks->size()));
+
+    this->processRanges(*blocks, ranges);
+    util::Logger::WriteLn("", false);
+
+    this->cropResult(pixels, box, region);
+
+    util::deallocVar(blocks);
+    util::deallocPlane(pixels);
+
+    return true;
+}
+
+/**
+ *  @brief  Replace the output stream with the given region of the decoded pixels.
+ *
+ *  @param  pixels
+ *      The decoded pixels of the rectangle area.
+ *  @param  area
+ *      The position and size of pixels in the image.
+ *  @param  region
+ *      The pixel rectangle to keep, inside area.
+ */
+void dc::ImageDecoder::cropResult(const uint8_t * const pixels, const dc::TileRect &area, const dc::TileRect &region) {
+    util::BitStreamWriter *result = util::allocVar<util::BitStreamWriter>(region.width * region.height,
+                                                                          util::PLANE_UNINITIALISED);
+    uint8_t *dest = result->get_buffer();
+
+    for (size_t y = 0; y < region.height; y++) {
+        std::memcpy(&dest[y * region.width],
+                    &pixels[(region.y - area.y + y) * area.width + (region.x - area.x)],
+                    region.width);
+    }
+
+    result->set_position(result->get_size_bits());
+
+    util::deallocVar(this->writer);
+    this->writer = result;
+}
+
+/**
+ *  @brief  Process the image for decoding with adaptive Block sizes.
+ *
+ *          1. Read the partition of every MacroBlock from the split flags,
+ *             and load every Block from the stream as soon as it is created
+ *          2. Perform iDCT and multiply with the quant_matrix resampled to the Block size
+ *          3. Expand the results to the byte stream
+ *
+ *  @return Returns true on success.
+ */
+bool dc::ImageDecoder::processAdaptive(void) {
+    util::BitStreamReader &reader = *this->reader;
+    const bool use_rle = this->use_rle;
+
+    // Reading raw must happen in sequence
+    dc::AdaptiveBlocks *adaptive = ImageProcessor::createAdaptiveBlocks(
+        this->writer->get_buffer(),
+        [&](const dc::PartitionNode&) {
+            return reader.get_bit() != 0;
+        },
+        [&](const dc::PartitionNode &node, dc::AdaptiveBlocks &blocks) {
+            dc::dispatchBlockSize(node.size, [&](auto bsize) {
+                blocks.get<decltype(bsize)::value>()[node.index].loadFromStream(reader, use_rle);
+            });
+        },
+        this->scale);
+
+    double quant[3][dc::MaxBlockSize * dc::MaxBlockSize];
+    ImageProcessor::getAdaptiveQuantData(quant);
+
+    util::Logger::WriteLn("[ImageDecoder] Processing adaptive Blocks...");
+
+    for (size_t q = 0; q < 3u; q++) {
+        dc::dispatchBlockSize(dc::MinBlockSize << q, [&](auto bsize) {
+            dc::BlockList<bsize> &blocks = adaptive->get<decltype(bsize)::value>();
+
+            #ifdef ENABLE_OPENMP
+                #pragma omp parallel for schedule(dynamic)
+            #endif
+            for (auto it = blocks.begin(); it < blocks.end(); it++) {
+                this->reconstructBlock(*it, quant[q]);
+            }
+
+            util::Logger::WriteLn(std::string_format("[ImageDecoder] %2dx%-2d Blocks: %d",
+                                                     bsize(), bsize(), blocks.size()));
+        });
+    }
+
+    util::deallocVar(adaptive);
+
+    return true;
+}
+
 /**
  *  @brief  Save the resulting stream to the destination.
  */
@@ -10,12 +10,43 @@ namespace dc {
      */
     class ImageDecoder : public ImageProcessor {
         private:
+            size_t scale;   ///< The factor the output is smaller than the image (width and height), see processScaled().
+
+            void verifySettings(void) const;
+
+            template<size_t bsize>
+            bool processBlocks(void);
+            bool processAdaptive(void);
+
+            template<size_t bsize>
+            void processRanges(dc::BlockList<bsize>&, const std::vector<dc::BlockRange>&);
+            template<size_t bsize>
+            void processLoaded(dc::BlockList<bsize>&);
+            template<size_t bsize>
+            bool processTiles(const dc::TileRect&);
+            void cropResult(const uint8_t * const, const dc::TileRect&, const dc::TileRect&);
+
+            /**
+             *  @brief  Transform a loaded Block and expand it to the output, at this->scale.
+             */
+            template<size_t bsize>
+            inline void reconstructBlock(dc::Block<bsize> &b, const double m[]) const {
+                if (this->scale == 1u) {
+                    b.processIDCTMulQ(m);
+                    b.expand();
+                } else {
+                    b.expandScaled(m);
+                }
+            }
 
         public:
             ImageDecoder(const std::string &source_file, const std::string &dest_file);
+            ImageDecoder(uint8_t * const data, const size_t length, const std::string &dest_file);
             ~ImageDecoder(void);
 
             bool process(void);
+            bool processRegion(const dc::TileRect&);
+            bool processScaled(const size_t);
             void saveResult(void) const;
     };
 }
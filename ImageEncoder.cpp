@@ -2,9 +2,38 @@
 #include "main.hpp"
 #include "Logger.hpp"
 #include "utils.hpp"
-#include "Huffman.hpp"
 
 #include <cassert>
+#include <cmath>
+#include <unordered_map>
+
+/**
+ *  @brief  Maximum pixel variance for a node of the adaptive partition to not be split,
+ *          relative to the squared DC quantization step.
+ *          Index 0 is for 8x8 nodes, 1 for 16x16 nodes.
+ */
+static constexpr double SPLIT_VARIANCE_FACTOR[] = { 8.0, 2.0 };
+
+/**
+ *  @brief  Calculate the pixel variance of a square region.
+ */
+static double RegionVariance(const uint8_t * const pixels, const size_t width, const dc::PartitionNode &node) {
+    size_t sum = 0u, sum_sq = 0u;
+
+    for (size_t y = node.y; y < node.y + node.size; y++) {
+        const uint8_t *row = &pixels[y * width + node.x];
+
+        for (size_t x = 0; x < node.size; x++) {
+            sum    += row[x];
+            sum_sq += size_t(row[x]) * row[x];
+        }
+    }
+
+    const double count = double(node.size) * node.size;
+    const double mean  = double(sum) / count;
+
+    return double(sum_sq) / count - mean * mean;
+}
 
 /**
  *  @brief  dc::Encoder::Encoder
@@ -17,15 +46,101 @@
  *  @param  height
  *  @param  use_rle
  *  @param  quant_m
+ *  @param  adaptive
+ *      Whether every MacroBlock selects its own Block size(s),
+ *      instead of using the size of quant_m for the entire image.
+ *  @param  index_interval
+ *      Write the bit offset of every index_interval'th Block to the header,
+ *      so the decoder can parse ranges of Blocks in parallel (0: no index).
+ *      Ignored for adaptive Block sizes.
+ *  @param  tile_size
+ *      Store the Blocks in independent tiles of (tile_size*tile_size) pixels, with an offset
+ *      for every tile in the header, so a region can be decoded on its own (0: not tiled).
+ *      Rounded down to a multiple of the Block size, ignored for adaptive Block sizes.
+ *  @param  progressive
+ *      Whether to store the DC coefficients of every Block first, followed by bands of AC coefficients,
+ *      so a truncated stream still gives a preview. Disables the block and tile index,
+ *      ignored for adaptive Block sizes.
+ *  @param  dedup
+ *      1: find Blocks with the same pixels as a Block before them (see findRepeatedBlocks())
+ *      and copy its coefficients instead of transforming them again, the stream is unchanged.
+ *      2: also stream a repeated Block as a reference to that Block (see streamDeduplicated()),
+ *      which disables the block and tile index and the progressive layout.
+ *      Ignored for adaptive Block sizes.
  */
 dc::ImageEncoder::ImageEncoder(const std::string &source_file, const std::string &dest_file,
-                               const uint16_t &width, const uint16_t &height, const bool &use_rle,
-                               MatrixReader<> &quant_m)
+                               const uint32_t &width, const uint32_t &height, const bool &use_rle,
+                               MatrixReader<> &quant_m, const bool &adaptive,
+                               const uint32_t &index_interval, const uint32_t &tile_size,
+                               const bool &progressive, const uint8_t &dedup)
     : ImageProcessor(source_file, dest_file, width, height, use_rle, quant_m)
+    , uniform_blocks(0u)
+    , dedup(0u)
 {
-    assert(this->width  % dc::BlockSize == 0);
-    assert(this->height % dc::BlockSize == 0);
-    assert(this->reader->get_size() == size_t(this->width * this->height));
+    this->setLayout(adaptive, index_interval, tile_size, progressive, dedup);
+}
+
+/**
+ *  @brief  Ctor for a raw image in memory (e.g. a level of a pyramid, see PyramidEncoder),
+ *          the result is kept in the stream (see getStream()) instead of saved.
+ *
+ *  @param  raw
+ *      Pointer to the (width*height) pixels, it is not owned and must outlive the encoder.
+ *
+ *  See the default ctor for the other parameters.
+ */
+dc::ImageEncoder::ImageEncoder(uint8_t * const raw,
+                               const uint32_t &width, const uint32_t &height, const bool &use_rle,
+                               MatrixReader<> &quant_m, const bool &adaptive,
+                               const uint32_t &index_interval, const uint32_t &tile_size,
+                               const bool &progressive, const uint8_t &dedup)
+    : ImageProcessor(raw, width, height, use_rle, quant_m)
+    , uniform_blocks(0u)
+    , dedup(0u)
+{
+    this->setLayout(adaptive, index_interval, tile_size, progressive, dedup);
+}
+
+/**
+ *  @brief  Apply the layout settings of the ctor, see the default ctor for the parameters.
+ */
+void dc::ImageEncoder::setLayout(const bool &adaptive, const uint32_t &index_interval,
+                                 const uint32_t &tile_size, const bool &progressive, const uint8_t &dedup)
+{
+    this->adaptive = adaptive;
+
+    // Blocks of an adaptive partition are interleaved with split flags, so they are parsed in sequence
+    this->index_interval = adaptive ? 0u : index_interval;
+
+    // Tiles consist of whole Blocks
+    this->tile_size = adaptive ? 0u : tile_size - tile_size % this->getBlockSize();
+
+    // The Blocks of an adaptive partition have different sizes, so they are not compared
+    this->dedup = adaptive ? 0u : std::min(dedup, uint8_t(2u));
+
+    // A reference can point to any Block before it, so Blocks are parsed in sequence
+    this->deduplicated = this->dedup == 2u;
+
+    // The bands of a Block are spread over the stream, so Blocks have no offset of their own
+    this->progressive = progressive && !adaptive && !this->deduplicated;
+
+    if (this->progressive || this->deduplicated) {
+        this->index_interval = 0u;
+        this->tile_size      = 0u;
+    }
+
+    if (this->deduplicated && (index_interval != 0u || tile_size != 0u || progressive)) {
+        util::Logger::WriteLn("[ImageEncoder] Block references disable the block index, tiles and the progressive layout.");
+    }
+
+    if (tile_size != this->tile_size) {
+        util::Logger::WriteLn(std::string_format("[ImageEncoder] Tile size %d changed to %d (multiple of the Block size, no adaptive Block sizes).",
+                                                 tile_size, this->tile_size));
+    }
+
+    assert(this->width  % this->getBlockSize() == 0);
+    assert(this->height % this->getBlockSize() == 0);
+    assert(this->reader->get_size() == size_t(this->width) * this->height);
 }
 
 /**
@@ -38,14 +153,9 @@ dc::ImageEncoder::~ImageEncoder(void) {
 /**
  *  @brief  Process the raw image for encoding.
  *
- *          1. Create Blocks
- *          2. Determine header length
- *          3. Estimate final stream length (header + size for each Block)
- *          4. Write header (encoding settings)
- *      For each Block:
- *          5. Perform DCT and divide with the quant_matrix
- *          6. Create the RLE sequence
- *          7. Stream the results to the byte stream, ignoring trailing zeroes if use_rle == true
+ *          Select the Block size from the quantization matrix
+ *          and call processBlocks() for that size (or processAdaptive()),
+ *          then apply Huffman encoding on the result (if enabled).
  *
  *  @return Returns true on success.
  */
@@ -54,124 +164,287 @@ bool dc::ImageEncoder::process(void) {
 
     util::Logger::WriteLn("[ImageEncoder] Processing image...");
 
-    // Pre-process image
-    success = ImageProcessor::process(this->reader->get_buffer());
-
-    // Write setting header
-    util::Logger::WriteLn("[ImageEncoder] Creating settings header...");
-    size_t output_length;
-
-    const uint8_t quant_bit_len = this->quant_m.getMaxBitLength();
-    output_length = dc::ImageProcessor::RLE_BITS       // Bit for RLE setting
-                  + dc::ImageProcessor::DIM_BITS * 2u  // 2 times bits for image dimension
-                  + dc::MatrixReader<>::SIZE_LEN_BITS  // Bits to signify size of quant_matrix contents
-                  + (quant_bit_len                     // Size of quantmatrix
-                     * dc::BlockSize * dc::BlockSize);
-
-    util::Logger::WriteLn(std::string_format("[ImageEncoder] Settings header length: %.1f bytes.",
-                                             float(output_length) / 8.f));
-
-    output_length += this->blocks->size() * this->blocks->front()->streamSize();
-    #ifndef ENABLE_HUFFMAN
-        output_length++;    // Add one bit to signal Huffman is not enabled.
-    #endif
-
-    output_length = util::round_to_byte(output_length);     // Padding to next whole byte
+    if (this->adaptive) {
+        success = this->processAdaptive();
+    } else {
+        success = dc::dispatchBlockSize(this->getBlockSize(), [this](auto bsize) {
+            return this->processBlocks<decltype(bsize)::value>();
+        });
+    }
 
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[ImageEncoder] Unsupported block size %d!",
+                                                 this->getBlockSize()));
+        return false;
+    }
 
-    this->writer = util::allocVar<util::BitStreamWriter>(output_length);
+    ImageProcessor::compressStream();
 
-    #ifndef ENABLE_HUFFMAN
-        this->writer->put_bit(0); // '0': No Huffman sequence present.
-    #endif
-
-    // Write matrix data first
-    this->quant_m.write(*this->writer);
+    return success;
+}
 
-    // Write other settings
-    this->writer->put(dc::ImageProcessor::RLE_BITS, uint32_t(this->use_rle));
-    this->writer->put(dc::ImageProcessor::DIM_BITS, this->width);
-    this->writer->put(dc::ImageProcessor::DIM_BITS, this->height);
+/**
+ *  @brief  Process the raw image for encoding with (bsize*bsize) Blocks.
+ *
+ *          1. Create Blocks
+ *      For each Block:
+ *          2. Perform DCT and divide with the quant_matrix
+ *          3. Create the RLE sequence
+ *          4. Write header (encoding settings) and stream the results in the layout of the settings,
+ *             see ImageProcessor::streamBlocks()
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @return Returns true on success.
+ */
+template<size_t bsize>
+bool dc::ImageEncoder::processBlocks(void) {
+    // Pre-process image
+    dc::BlockList<bsize> *blocks = ImageProcessor::createBlocks<bsize>(this->reader->get_buffer());
 
-    const size_t block_count = this->blocks->size();
+    const size_t block_count = blocks->size();
     size_t blockid = 0u;
 
+    // The first Block with the same pixels for every Block (itself if there is none)
+    const std::vector<size_t> source = this->dedup != 0u ? this->findRepeatedBlocks(*blocks) : std::vector<size_t>();
+
     util::Logger::WriteLn("[ImageEncoder] Processing Blocks...");
     util::Logger::WriteProgress(0, block_count);
 
     #ifdef LOG_LOCAL
-        for (Block<>* b : *this->blocks) {
+        for (Block<bsize>& b : *blocks) {
             util::Logger::WriteLn(std::string_format("Block % 3d:", blockid++));
-            b->printExpanded();
+            b.printExpanded();
             util::Logger::WriteLn("", false);
 
             util::Logger::WriteLn("After DCT and quantization:");
-            b->processDCTDivQ(this->quant_m.getData());
-            b->printExpanded();
+            b.processDCTDivQ(this->quant_m.getZigzagData());
+            b.printExpanded();
             util::Logger::WriteLn("", false);
 
-            b->printZigzag();
-            b->createRLESequence();
-            b->printRLE();
-
-            b->streamEncoded(*this->writer, this->use_rle);
+            b.printZigzag();
+            b.createRLESequence();
+            b.printRLE();
             util::Logger::WriteLn("", false);
         }
     #else
         #ifdef ENABLE_OPENMP
             #pragma omp parallel for shared(blockid) schedule(dynamic)
-            for (auto it = this->blocks->begin(); it < this->blocks->end(); it++) {
-                Block<> *b = *it;
-                b->processDCTDivQ(this->quant_m.getData());
-                b->createRLESequence();
+        #endif
+        for (auto it = blocks->begin(); it < blocks->end(); it++) {
+            Block<bsize> &b = *it;
+            const size_t i  = size_t(it - blocks->begin());
+
+            if (!source.empty() && source[i] != i) {
+                // Copied from its source after all sources are processed
+            } else if (b.processUniformDivQ(this->quant_m.getZigzagData())) {
+                #ifdef ENABLE_OPENMP
+                    #pragma omp atomic
+                #endif
+                ++this->uniform_blocks;
+            } else {
+                b.processDCTDivQ(this->quant_m.getZigzagData());
+                b.createRLESequence();
+            }
 
+            #ifdef ENABLE_OPENMP
                 #pragma omp atomic
-                ++blockid;
+            #endif
+            ++blockid;
 
+            #ifdef ENABLE_OPENMP
                 #pragma omp critical
-                util::Logger::WriteProgress(blockid, block_count);
-            }
-
-            // Writing results must happen in sequence
-            for (Block<>* b : *this->blocks) {
-                b->streamEncoded(*this->writer, this->use_rle);
-            }
-        #else
-            for (Block<>* b : *this->blocks) {
-                b->processDCTDivQ(this->quant_m.getData());
-                b->createRLESequence();
-                b->streamEncoded(*this->writer, this->use_rle);
-                util::Logger::WriteProgress(++blockid, block_count);
-            }
-        #endif
+            #endif
+            util::Logger::WriteProgress(blockid, block_count);
+        }
     #endif
 
     util::Logger::WriteLn("", false);
 
-    #ifdef ENABLE_HUFFMAN
-        util::BitStreamReader hm_input(this->writer->get_buffer(),
-                                       this->writer->get_last_byte_position());
+    size_t repeated_blocks = 0u;
 
-        algo::Huffman<> hm;
-        util::BitStreamWriter *hm_output = hm.encode(hm_input);
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for reduction(+:repeated_blocks) schedule(static)
+    #endif
+    for (size_t i = 0; i < source.size(); i++) {
+        if (source[i] != i) {
+            (*blocks)[i].copyCoefficientsFrom((*blocks)[source[i]]);
+            ++repeated_blocks;
+        }
+    }
 
-        #ifdef LOG_LOCAL
-            util::Logger::WriteLn("\n", false);
-            hm.printDict();
-//            util::Logger::WriteLn("\n", false);
-//            hm.printTree();
-            util::Logger::WriteLn("\n", false);
-        #endif
+    // Write setting header and results, in the layout of the settings
+    if (this->deduplicated) {
+        this->streamDeduplicated(*blocks, source);
+    } else {
+        ImageProcessor::streamBlocks(*blocks);
+    }
 
-        if (hm_output != nullptr) {
-            util::deallocVar(this->writer);
-            this->writer = hm_output;
-        }
+    util::Logger::WriteLn(std::string_format("[ImageEncoder] Uniform Blocks (DCT skipped): %d of %d",
+                                             this->uniform_blocks, block_count));
 
-        util::Logger::WriteLn("", false);
+    if (this->dedup != 0u) {
+        util::Logger::WriteLn(std::string_format("[ImageEncoder] Repeated Blocks (DCT skipped%s): %d of %d",
+                                                 this->deduplicated ? ", streamed as reference" : "",
+                                                 repeated_blocks, block_count));
+    }
+
+    util::deallocVar(blocks);
+
+    return true;
+}
+
+/**
+ *  @brief  Find the first Block with the same pixels for every Block.
+ *
+ *          The pixels of every Block are hashed in parallel (see Block::hashPixels()),
+ *          then the hashes are looked up in order. A Block with the hash of an earlier Block
+ *          is only a repeat if their pixels are equal (see Block::hasSamePixels()).
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @return Returns the index of the source of every Block in the list, itself if it is not a repeat.
+ */
+template<size_t bsize>
+std::vector<size_t> dc::ImageEncoder::findRepeatedBlocks(const dc::BlockList<bsize> &blocks) const {
+    const size_t block_count = blocks.size();
+    std::vector<uint64_t> hashes(block_count);
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for schedule(static)
     #endif
+    for (size_t i = 0; i < block_count; i++) {
+        hashes[i] = blocks[i].hashPixels();
+    }
 
-    return success;
+    std::vector<size_t> source(block_count);
+    std::unordered_map<uint64_t, size_t> first;
+    first.reserve(block_count);
+
+    for (size_t i = 0; i < block_count; i++) {
+        const auto found = first.emplace(hashes[i], i);
+
+        // On a hash collision the Block is kept, later repeats of it are not found
+        source[i] = (!found.second && blocks[i].hasSamePixels(blocks[found.first->second].getView()))
+                  ? found.first->second
+                  : i;
+    }
+
+    return source;
+}
+
+/**
+ *  @brief  Write header (encoding settings) and stream the Blocks, with a repeated Block as a reference.
+ *
+ *          Every Block starts with a flag bit:
+ *          0: the Block follows (see Block::streamEncoded()),
+ *          1: the index of its source among the Blocks streamed before it follows,
+ *             with ImageProcessor::getReferenceLength() bits.
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  blocks
+ *      The Blocks, after quantization and creating the RLE sequence.
+ *  @param  source
+ *      The source of every Block, see findRepeatedBlocks().
+ */
+template<size_t bsize>
+void dc::ImageEncoder::streamDeduplicated(dc::BlockList<bsize> &blocks, const std::vector<size_t> &source) {
+    const size_t block_count = blocks.size();
+
+    // The amount of Blocks streamed before every Block, which is the reference to a streamed Block
+    std::vector<size_t> streamed(block_count + 1u, 0u);
+    size_t data_length = 0u;
+
+    for (size_t i = 0; i < block_count; i++) {
+        const bool repeat = source[i] != i;
+
+        streamed[i + 1u] = streamed[i] + (repeat ? 0u : 1u);
+        data_length     += 1u + (repeat ? ImageProcessor::getReferenceLength(streamed[i])
+                                        : blocks[i].streamLength(this->use_rle));
+    }
+
+    util::Logger::WriteLn(std::string_format("[ImageEncoder] Streaming %d unique Blocks.", streamed.back()));
+
+    // Write setting header
+    ImageProcessor::createHeader(data_length);
+
+    // Writing results must happen in sequence, so every thread writes its own range
+    ImageProcessor::streamParallel(block_count, 1u + Block<bsize>::MAX_STREAM_BITS,
+                                   [&](const size_t i, util::BitStreamWriter &writer) {
+        if (source[i] == i) {
+            writer.put_bit(0);
+            blocks[i].streamEncoded(writer, this->use_rle);
+        } else {
+            writer.put_bit(1);
+            writer.put(ImageProcessor::getReferenceLength(streamed[i]), uint32_t(streamed[source[i]]));
+        }
+    });
+}
+
+/**
+ *  @brief  Process the raw image for encoding with adaptive Block sizes.
+ *
+ *          1. Partition every MacroBlock into 16x16, 8x8 or 4x4 Blocks:
+ *             a node is split if its pixel variance is too high for its size
+ *          2. Perform DCT, quantization and RLE on all Blocks of every size,
+ *             with the quantization matrix resampled to that size
+ *          3. Write header (encoding settings) and stream every split flag and Block in partition order,
+ *             see ImageProcessor::streamAdaptive()
+ *
+ *  @return Returns true on success.
+ */
+bool dc::ImageEncoder::processAdaptive(void) {
+    const uint8_t * const pixels = this->reader->get_buffer();
+    const double dc_step = this->quant_m.getData()[0];
+    const size_t width   = this->width;
+
+    dc::AdaptiveBlocks *adaptive = ImageProcessor::createAdaptiveBlocks(
+        this->reader->get_buffer(),
+        [=](const dc::PartitionNode &node) {
+            const double max_variance = SPLIT_VARIANCE_FACTOR[node.size == dc::MacroBlockSize] * dc_step * dc_step;
+            return RegionVariance(pixels, width, node) > max_variance;
+        },
+        [](const dc::PartitionNode&, dc::AdaptiveBlocks&) {});
+
+    double quant[3][dc::MaxBlockSize * dc::MaxBlockSize];
+    ImageProcessor::getAdaptiveQuantData(quant);
+
+    util::Logger::WriteLn("[ImageEncoder] Processing adaptive Blocks...");
+
+    for (size_t q = 0; q < 3u; q++) {
+        dc::dispatchBlockSize(dc::MinBlockSize << q, [&](auto bsize) {
+            dc::BlockList<bsize> &blocks = adaptive->get<decltype(bsize)::value>();
+
+            #ifdef ENABLE_OPENMP
+                #pragma omp parallel for schedule(dynamic)
+            #endif
+            for (auto it = blocks.begin(); it < blocks.end(); it++) {
+                if (it->processUniformDivQ(quant[q])) {
+                    #ifdef ENABLE_OPENMP
+                        #pragma omp atomic
+                    #endif
+                    ++this->uniform_blocks;
+                } else {
+                    it->processDCTDivQ(quant[q]);
+                    it->createRLESequence();
+                }
+            }
+
+            util::Logger::WriteLn(std::string_format("[ImageEncoder] %2dx%-2d Blocks: %d",
+                                                     bsize(), bsize(), blocks.size()));
+        });
+    }
+
+    // Write setting header, then every split flag and Block in partition order
+    ImageProcessor::streamAdaptive(*adaptive);
+
+    util::Logger::WriteLn(std::string_format("[ImageEncoder] Uniform Blocks (DCT skipped): %d",
+                                             this->uniform_blocks));
+
+    util::deallocVar(adaptive);
+
+    return true;
 }
 
 /**
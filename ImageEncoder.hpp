@@ -11,15 +11,42 @@ namespace dc {
      */
     class ImageEncoder : public ImageProcessor {
         private:
+            size_t uniform_blocks;  ///< Amount of Blocks that skipped the DCT (see Block::processUniformDivQ).
+            uint8_t dedup;          ///< 0: every Block is transformed, 1: a repeated Block copies the coefficients of the first Block with the same pixels, 2: and is streamed as a reference.
+
+            void setLayout(const bool&, const uint32_t&, const uint32_t&, const bool&, const uint8_t&);
+
+            template<size_t bsize>
+            bool processBlocks(void);
+            bool processAdaptive(void);
+
+            template<size_t bsize>
+            std::vector<size_t> findRepeatedBlocks(const dc::BlockList<bsize>&) const;
+            template<size_t bsize>
+            void streamDeduplicated(dc::BlockList<bsize>&, const std::vector<size_t>&);
 
         public:
             ImageEncoder(const std::string &source_file, const std::string &dest_file,
-                         const uint16_t &width, const uint16_t &height, const bool &use_rle,
-                         MatrixReader<> &m);
+                         const uint32_t &width, const uint32_t &height, const bool &use_rle,
+                         MatrixReader<> &m, const bool &adaptive = false,
+                         const uint32_t &index_interval = 0u, const uint32_t &tile_size = 0u,
+                         const bool &progressive = false, const uint8_t &dedup = 0u);
+            ImageEncoder(uint8_t * const raw,
+                         const uint32_t &width, const uint32_t &height, const bool &use_rle,
+                         MatrixReader<> &m, const bool &adaptive = false,
+                         const uint32_t &index_interval = 0u, const uint32_t &tile_size = 0u,
+                         const bool &progressive = false, const uint8_t &dedup = 0u);
             ~ImageEncoder(void);
 
             bool process(void);
             void saveResult(void) const;
+
+            /**
+             *  @brief  Get the encoded stream, after process().
+             */
+            inline const util::BitStreamWriter& getStream(void) const {
+                return *this->writer;
+            }
     };
 }
 
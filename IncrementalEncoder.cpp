@@ -0,0 +1,256 @@
+#include "IncrementalEncoder.hpp"
+#include "main.hpp"
+#include "Logger.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+
+/**
+ *  @brief  Read a raw image file, log an error if it can not be read.
+ *
+ *  @return Returns the pixels (deallocate with util::deallocPlane()), or nullptr.
+ */
+static uint8_t* ReadRawImage(const std::string &file, size_t &size) {
+    try {
+        return util::readBinaryFile(file, size);
+    } catch (Exceptions::FileReadException const& e) {
+        util::Logger::WriteLn(e.getMessage());
+        size = 0u;
+        return nullptr;
+    }
+}
+
+/**
+ *  @brief  Default ctor, reads the settings header of the previous encoded image and both raw images.
+ *
+ *  @param  previous_raw
+ *      Path to the raw image that previous_enc was encoded from.
+ *  @param  previous_enc
+ *      Path to the encoded previous image. A block index (or tiles) lets unchanged ranges of Blocks
+ *      be copied without parsing them.
+ *  @param  source_file
+ *      Path to the new raw image, with the same dimensions.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ */
+dc::IncrementalEncoder::IncrementalEncoder(const std::string &previous_raw, const std::string &previous_enc,
+                                           const std::string &source_file, const std::string &dest_file)
+    : ImageProcessor(previous_enc, dest_file)
+{
+    this->previous = ReadRawImage(previous_raw, this->previous_size);
+    this->current  = ReadRawImage(source_file, this->current_size);
+
+    util::Logger::WriteLn(std::string_format("[IncrementalEncoder] Loaded %dx%d image (%dx%d blocks) with %.1f bytes.",
+                                             this->width, this->height, this->getBlockSize(), this->getBlockSize(),
+                                             float(this->reader->get_size())));
+}
+
+/**
+ *  @brief  Default dtor
+ */
+dc::IncrementalEncoder::~IncrementalEncoder(void) {
+    util::deallocPlane(this->previous);
+    util::deallocPlane(this->current);
+}
+
+/**
+ *  @brief  Process the changes between the raw images.
+ *
+ *          Select the Block size from the quantization matrix in the stream
+ *          and call processBlocks() for that size,
+ *          then apply Huffman encoding on the result (if enabled).
+ *
+ *  @return Returns true on success.
+ */
+bool dc::IncrementalEncoder::process(void) {
+    util::Logger::WriteLn("[IncrementalEncoder] Processing image...");
+
+    const size_t pixels = size_t(this->width) * this->height;
+
+    if (this->previous_size != pixels || this->current_size != pixels) {
+        util::Logger::WriteLn(std::string_format("[IncrementalEncoder] The raw images (%d and %d bytes) do not match the %dx%d encoded image!",
+                                                 this->previous_size, this->current_size, this->width, this->height));
+        return false;
+    }
+
+    // Every Block must start right after the previous one, so it can be replaced on its own
+    if (this->adaptive || this->progressive || this->deduplicated) {
+        util::Logger::WriteLn("[IncrementalEncoder] Adaptive Block sizes, progressive and deduplicated images are not supported!");
+        return false;
+    }
+
+    const bool success = dc::dispatchBlockSize(this->getBlockSize(), [this](auto bsize) {
+        return this->processBlocks<decltype(bsize)::value>();
+    });
+
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[IncrementalEncoder] Unsupported block size %d!",
+                                                 this->getBlockSize()));
+        return false;
+    }
+
+    ImageProcessor::compressStream();
+
+    return success;
+}
+
+/**
+ *  @brief  Encode the changed Blocks of the image with (bsize*bsize) Blocks,
+ *          and copy the bits of the other Blocks from the previous stream.
+ *
+ *          1. Create Blocks from the new pixels, and compare every Block
+ *             to the same Block of the previous pixels (see Block::hasSamePixels())
+ *          2. Find the bit offset of every Block in the ranges of the block or tile index
+ *             that contain a changed Block (see Block::SkipInStream()), and the end of the last range
+ *          3. Perform DCT, quantization and RLE on the changed Blocks
+ *          4. Move the offsets of the block and tile index by the size difference of the changed Blocks before them
+ *          5. Write header, then copy every run of unchanged Blocks from the previous stream
+ *             and stream every changed Block
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @return Returns true on success.
+ */
+template<size_t bsize>
+bool dc::IncrementalEncoder::processBlocks(void) {
+    dc::BlockList<bsize> *blocks = ImageProcessor::createBlocks<bsize>(this->current);
+
+    const size_t block_count = blocks->size();
+    size_t changed_blocks = 0u;
+    std::vector<uint8_t> changed(block_count, 0u);
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for reduction(+:changed_blocks) schedule(static)
+    #endif
+    for (size_t i = 0; i < block_count; i++) {
+        dc::BlockView before = (*blocks)[i].getView();
+        before.base = this->previous;
+
+        changed[i]      = !(*blocks)[i].hasSamePixels(before);
+        changed_blocks += changed[i];
+    }
+
+    util::Logger::WriteLn(std::string_format("[IncrementalEncoder] Changed Blocks: %d of %d",
+                                             changed_blocks, block_count));
+
+    // Without a block index or tiles, the Block data is one range
+    std::vector<dc::BlockRange> ranges = ImageProcessor::getBlockRanges<bsize>();
+
+    if (ranges.empty()) {
+        util::Logger::WriteLn("[IncrementalEncoder] No block index or tiles, every Block is parsed.");
+        ranges.push_back(dc::BlockRange { 0u, 0u });
+    }
+
+    const size_t data_start = this->reader->get_position();
+    util::BitStreamReader &source = *this->reader;
+
+    // Bit offset of every Block (relative to data_start), known for the first Block of every range
+    // and every Block of the ranges that are parsed
+    std::vector<size_t> offsets(block_count + 1u, 0u);
+    std::vector<uint8_t> parsed(ranges.size(), 0u);
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (size_t r = 0; r < ranges.size(); r++) {
+        const size_t begin = ranges[r].first;
+        const size_t end   = (r + 1u < ranges.size()) ? ranges[r + 1u].first : block_count;
+
+        offsets[begin] = ranges[r].offset;
+
+        // The end of the last range is only known after parsing it
+        parsed[r] = r + 1u == ranges.size()
+                 || std::any_of(changed.begin() + ptrdiff_t(begin), changed.begin() + ptrdiff_t(end),
+                                [](const uint8_t c) { return c != 0u; });
+
+        if (!parsed[r]) {
+            continue;
+        }
+
+        util::BitStreamReader reader(source.get_buffer(), source.get_size());
+        reader.set_position(data_start + ranges[r].offset);
+
+        for (size_t i = begin; i < end; i++) {
+            offsets[i] = reader.get_position() - data_start;
+            dc::Block<bsize>::SkipInStream(reader, this->use_rle);
+        }
+
+        if (end == block_count) {
+            offsets[block_count] = reader.get_position() - data_start;
+        }
+    }
+
+    util::Logger::WriteLn("[IncrementalEncoder] Processing changed Blocks...");
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (size_t i = 0; i < block_count; i++) {
+        if (changed[i]) {
+            Block<bsize> &b = (*blocks)[i];
+
+            if (!b.processUniformDivQ(this->quant_m.getZigzagData())) {
+                b.processDCTDivQ(this->quant_m.getZigzagData());
+                b.createRLESequence();
+            }
+        }
+    }
+
+    // Size difference of all changed Blocks before every Block
+    std::vector<ptrdiff_t> growth(block_count + 1u, 0);
+
+    for (size_t i = 0; i < block_count; i++) {
+        growth[i + 1u] = growth[i] + (changed[i] ? ptrdiff_t((*blocks)[i].streamLength(this->use_rle))
+                                                 - ptrdiff_t(offsets[i + 1u] - offsets[i])
+                                                 : 0);
+    }
+
+    // Only the Blocks after a changed Block move
+    for (size_t i = 0; i < this->block_index.size(); i++) {
+        this->block_index[i] += size_t(growth[(i + 1u) * this->index_interval]);
+    }
+
+    for (size_t t = 1, first = 0; t < this->getTileCount(); t++) {
+        const dc::TileRect tile = this->getTileRect(t - 1u);
+
+        first += (tile.width / bsize) * (tile.height / bsize);
+        this->tile_index[t - 1u] += size_t(growth[first]);
+    }
+
+    // Write setting header
+    ImageProcessor::createHeader(size_t(ptrdiff_t(offsets[block_count]) + growth[block_count]));
+
+    // Copy every run of unchanged Blocks, a range that was not parsed is copied entirely
+    util::BitStreamWriter &writer = *this->writer;
+    size_t copy_from = 0u;
+
+    for (size_t r = 0; r < ranges.size(); r++) {
+        if (!parsed[r]) {
+            continue;
+        }
+
+        const size_t end = (r + 1u < ranges.size()) ? ranges[r + 1u].first : block_count;
+
+        for (size_t i = ranges[r].first; i < end; i++) {
+            if (changed[i]) {
+                writer.copy_bits(source.get_buffer(), data_start + copy_from, offsets[i] - copy_from);
+                (*blocks)[i].streamEncoded(writer, this->use_rle);
+
+                copy_from = offsets[i + 1u];
+            }
+        }
+    }
+
+    writer.copy_bits(source.get_buffer(), data_start + copy_from, offsets[block_count] - copy_from);
+
+    util::deallocVar(blocks);
+
+    return true;
+}
+
+/**
+ *  @brief  Save the resulting stream to the destination.
+ */
+void dc::IncrementalEncoder::saveResult(void) const {
+    ImageProcessor::saveResult(true);
+}
@@ -0,0 +1,35 @@
+#ifndef INCREMENTALENCODER_HPP
+#define INCREMENTALENCODER_HPP
+
+#include "ImageBase.hpp"
+
+namespace dc {
+    /**
+     *  @brief  The IncrementalEncoder class
+     *          Used to encode a new version of an image that was encoded by the ImageEncoder class,
+     *          when only some regions of the image changed (e.g. consecutive screenshots).
+     *          The previous raw image is compared to the new one Block by Block: only the changed Blocks
+     *          are transformed, the bits of every other Block are copied from the previous encoded stream.
+     *          The result is equal to encoding the new raw image with the settings of the previous stream.
+     */
+    class IncrementalEncoder : public ImageProcessor {
+        private:
+            uint8_t *previous;      ///< The pixels of the previous raw image, owned.
+            size_t   previous_size; ///< The size of the previous raw image in bytes.
+            uint8_t *current;       ///< The pixels of the new raw image, owned.
+            size_t   current_size;  ///< The size of the new raw image in bytes.
+
+            template<size_t bsize>
+            bool processBlocks(void);
+
+        public:
+            IncrementalEncoder(const std::string &previous_raw, const std::string &previous_enc,
+                               const std::string &source_file, const std::string &dest_file);
+            ~IncrementalEncoder(void);
+
+            bool process(void);
+            void saveResult(void) const;
+    };
+}
+
+#endif // INCREMENTALENCODER_HPP
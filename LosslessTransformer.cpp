@@ -0,0 +1,280 @@
+#include "LosslessTransformer.hpp"
+#include "main.hpp"
+#include "Logger.hpp"
+#include "utils.hpp"
+
+/**
+ *  @brief  The setting value for every orientation, see LosslessTransformer::ParseOrientation().
+ */
+static const std::string ORIENTATION_NAMES[] = {
+    "none", "fliph", "flipv", "transpose", "rotate90", "rotate180", "rotate270"
+};
+
+/**
+ *  @brief  Whether the orientation swaps the rows and columns (and the width and height).
+ */
+static inline bool IsTransposed(const dc::Orientation orientation) {
+    return orientation == dc::Orientation::transpose
+        || orientation == dc::Orientation::rotate_90
+        || orientation == dc::Orientation::rotate_270;
+}
+
+/**
+ *  @brief  Get the source of every coefficient of a Block in the new orientation.
+ *
+ *          With u the vertical and v the horizontal frequency, a horizontal flip negates the odd v,
+ *          a vertical flip negates the odd u and a transpose swaps u and v.
+ *          The rotations combine a transpose with a flip (90: horizontal, 270: vertical) or flip both ways (180).
+ *
+ *  @tparam bsize
+ *      The Block size.
+ *  @param  orientation
+ *      The orientation change.
+ *  @param  index
+ *      Output, for every zig-zag position the zig-zag position in the source Block.
+ *  @param  negate
+ *      Output, for every zig-zag position whether the coefficient changes sign.
+ */
+template<size_t bsize>
+static void CreateCoefficientMap(const dc::Orientation orientation, uint16_t index[], bool negate[]) {
+    uint16_t zigzag_pos[bsize * bsize];
+
+    for (size_t i = 0; i < bsize * bsize; i++) {
+        zigzag_pos[algo::ZigZagLUT<bsize>[i]] = uint16_t(i);
+    }
+
+    const bool transposed = IsTransposed(orientation);
+    const bool flip_h = orientation == dc::Orientation::flip_horizontal
+                     || orientation == dc::Orientation::rotate_90
+                     || orientation == dc::Orientation::rotate_180;
+    const bool flip_v = orientation == dc::Orientation::flip_vertical
+                     || orientation == dc::Orientation::rotate_270
+                     || orientation == dc::Orientation::rotate_180;
+
+    for (size_t i = 0; i < bsize * bsize; i++) {
+        const size_t u = algo::ZigZagLUT<bsize>[i] / bsize;
+        const size_t v = algo::ZigZagLUT<bsize>[i] % bsize;
+
+        index[i]  = transposed ? zigzag_pos[v * bsize + u] : zigzag_pos[u * bsize + v];
+        negate[i] = (flip_h && (v & 1u)) != (flip_v && (u & 1u));
+    }
+}
+
+/**
+ *  @brief  Get the source Block for a Block position in the new orientation.
+ *
+ *  @param  x
+ *  @param  y
+ *      The Block column and row in the new orientation.
+ *  @param  blocks_x
+ *  @param  blocks_y
+ *      The amount of Block columns and rows in the source image.
+ *  @return Returns the Block id in row order of the source image.
+ */
+static size_t SourceBlock(const dc::Orientation orientation, const size_t x, const size_t y,
+                          const size_t blocks_x, const size_t blocks_y)
+{
+    switch (orientation) {
+        case dc::Orientation::flip_horizontal: return y * blocks_x + (blocks_x - 1u - x);
+        case dc::Orientation::flip_vertical  : return (blocks_y - 1u - y) * blocks_x + x;
+        case dc::Orientation::transpose      : return x * blocks_x + y;
+        case dc::Orientation::rotate_90      : return (blocks_y - 1u - x) * blocks_x + y;
+        case dc::Orientation::rotate_180     : return (blocks_y - 1u - y) * blocks_x + (blocks_x - 1u - x);
+        case dc::Orientation::rotate_270     : return x * blocks_x + (blocks_x - 1u - y);
+        default                              : return y * blocks_x + x;
+    }
+}
+
+/**
+ *  @brief  Default ctor, reads the settings header of the encoded image.
+ *
+ *  @param  source_file
+ *      Path to an encoded image file.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ *  @param  orientation
+ *      The orientation change to apply.
+ *  @param  crop
+ *      The region to keep, in pixels of the changed orientation (width or height 0: the entire image).
+ *      The region is extended to whole Blocks.
+ */
+dc::LosslessTransformer::LosslessTransformer(const std::string &source_file, const std::string &dest_file,
+                                             const dc::Orientation &orientation, const dc::TileRect &crop)
+    : ImageProcessor(source_file, dest_file)
+    , orientation(orientation)
+    , crop(crop)
+{
+    util::Logger::WriteLn(std::string_format("[LosslessTransformer] Loaded %dx%d image (%dx%d blocks) with %.1f bytes.",
+                                             this->width, this->height, this->getBlockSize(), this->getBlockSize(),
+                                             float(this->reader->get_size())));
+}
+
+/**
+ *  @brief  Default dtor
+ */
+dc::LosslessTransformer::~LosslessTransformer(void) {
+    // Empty
+}
+
+/**
+ *  @brief  Get the orientation for a setting value ("none", "fliph", "flipv", "transpose",
+ *          "rotate90", "rotate180" or "rotate270").
+ *
+ *  @return Returns Orientation::AMOUNT for an unknown value.
+ */
+dc::Orientation dc::LosslessTransformer::ParseOrientation(const std::string &name) {
+    for (size_t i = 0; i < util::to_underlying(dc::Orientation::AMOUNT); i++) {
+        if (ORIENTATION_NAMES[i] == name) {
+            return dc::Orientation(i);
+        }
+    }
+
+    return dc::Orientation::AMOUNT;
+}
+
+/**
+ *  @brief  Process the encoded image for the orientation change and crop.
+ *
+ *          Select the Block size from the quantization matrix in the stream
+ *          and call processBlocks() for that size,
+ *          then apply Huffman encoding on the result (if enabled).
+ *
+ *  @return Returns true on success.
+ */
+bool dc::LosslessTransformer::process(void) {
+    util::Logger::WriteLn("[LosslessTransformer] Processing image...");
+
+    if (this->orientation == dc::Orientation::AMOUNT) {
+        util::Logger::WriteLn("[LosslessTransformer] Unknown orientation!");
+        return false;
+    }
+
+    // The partition follows the MacroBlock grid from the top-left corner, which moves when flipping
+    if (this->adaptive) {
+        util::Logger::WriteLn("[LosslessTransformer] Images with adaptive Block sizes are not supported!");
+        return false;
+    }
+
+    const size_t bsize  = this->getBlockSize();
+    const size_t width  = IsTransposed(this->orientation) ? this->height : this->width;
+    const size_t height = IsTransposed(this->orientation) ? this->width  : this->height;
+
+    dc::TileRect area { 0u, 0u, width, height };
+
+    if (this->crop.width != 0u && this->crop.height != 0u) {
+        if (this->crop.x + this->crop.width > width || this->crop.y + this->crop.height > height) {
+            util::Logger::WriteLn(std::string_format("[LosslessTransformer] Crop %dx%d at (%d, %d) is not inside the %dx%d image!",
+                                                     this->crop.width, this->crop.height, this->crop.x, this->crop.y,
+                                                     width, height));
+            return false;
+        }
+
+        // Extend to whole Blocks
+        area.x      = this->crop.x - this->crop.x % bsize;
+        area.y      = this->crop.y - this->crop.y % bsize;
+        area.width  = (this->crop.x + this->crop.width  + bsize - 1u) / bsize * bsize - area.x;
+        area.height = (this->crop.y + this->crop.height + bsize - 1u) / bsize * bsize - area.y;
+
+        if (area.x != this->crop.x || area.y != this->crop.y
+            || area.width != this->crop.width || area.height != this->crop.height)
+        {
+            util::Logger::WriteLn(std::string_format("[LosslessTransformer] Crop changed to %dx%d at (%d, %d) (multiple of the Block size).",
+                                                     area.width, area.height, area.x, area.y));
+        }
+    }
+
+    const bool success = dc::dispatchBlockSize(bsize, [&](auto bs) {
+        return this->processBlocks<decltype(bs)::value>(area);
+    });
+
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[LosslessTransformer] Unsupported block size %d!", bsize));
+        return false;
+    }
+
+    ImageProcessor::compressStream();
+
+    return success;
+}
+
+/**
+ *  @brief  Change the orientation and crop the image with (bsize*bsize) Blocks.
+ *
+ *          1. Create the Blocks of the source image and load them from the stream, see ImageProcessor::loadBlocks()
+ *          2. Create the Blocks of the result
+ *      For each Block:
+ *          3. Copy the coefficients of its source Block, reordered and negated (see Block::loadPermuted())
+ *          4. Create the RLE sequence
+ *          5. Write header (with the transposed matrix, if transposed) and stream the results
+ *             in the layout of the image, see ImageProcessor::streamBlocks()
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @param  area
+ *      The region to keep in the changed orientation, in whole Blocks.
+ *  @return Returns true on success.
+ */
+template<size_t bsize>
+bool dc::LosslessTransformer::processBlocks(const dc::TileRect &area) {
+    const size_t blocks_x = this->width  / bsize;
+    const size_t blocks_y = this->height / bsize;
+
+    // Blocks are created from pixels, which are never used here
+    uint8_t *pixels = util::allocPlane<uint8_t>(size_t(this->width) * this->height, util::PLANE_ZEROED);
+    dc::BlockList<bsize> *source = ImageProcessor::createBlocks<bsize>(pixels);
+
+    util::Logger::WriteLn("[LosslessTransformer] Loading Blocks...");
+    ImageProcessor::loadBlocks(*source);
+
+    // Position of every Block in the list, which is in tile order for a tiled image
+    std::vector<size_t> source_id(source->size());
+
+    for (size_t i = 0; i < source->size(); i++) {
+        const dc::BlockView &view = (*source)[i].getView();
+        source_id[(view.y / bsize) * blocks_x + view.x / bsize] = i;
+    }
+
+    this->width  = uint32_t(area.width);
+    this->height = uint32_t(area.height);
+
+    dc::BlockList<bsize> *blocks = ImageProcessor::createBlocks<bsize>(pixels);
+
+    uint16_t index[bsize * bsize];
+    bool negate[bsize * bsize];
+    CreateCoefficientMap<bsize>(this->orientation, index, negate);
+
+    util::Logger::WriteLn(std::string_format("[LosslessTransformer] Moving Blocks to a %dx%d image...",
+                                             this->width, this->height));
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for schedule(static)
+    #endif
+    for (size_t i = 0; i < blocks->size(); i++) {
+        dc::Block<bsize> &b = (*blocks)[i];
+        const size_t x = (area.x + b.getView().x) / bsize;
+        const size_t y = (area.y + b.getView().y) / bsize;
+
+        b.loadPermuted((*source)[source_id[SourceBlock(this->orientation, x, y, blocks_x, blocks_y)]], index, negate);
+        b.createRLESequence();
+    }
+
+    // Coefficient (u, v) was dequantised with the matrix element at (v, u)
+    if (IsTransposed(this->orientation)) {
+        this->quant_m.transpose();
+    }
+
+    ImageProcessor::streamBlocks(*blocks);
+
+    util::deallocVar(blocks);
+    util::deallocVar(source);
+    util::deallocPlane(pixels);
+
+    return true;
+}
+
+/**
+ *  @brief  Save the resulting stream to the destination.
+ */
+void dc::LosslessTransformer::saveResult(void) const {
+    ImageProcessor::saveResult(true);
+}
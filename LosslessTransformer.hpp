@@ -0,0 +1,48 @@
+#ifndef LOSSLESSTRANSFORMER_HPP
+#define LOSSLESSTRANSFORMER_HPP
+
+#include "ImageBase.hpp"
+
+namespace dc {
+    /**
+     *  @brief  The orientation changes a LosslessTransformer can apply.
+     */
+    enum class Orientation : uint8_t {
+        none = 0,
+        flip_horizontal,    ///< Mirror left and right.
+        flip_vertical,      ///< Mirror top and bottom.
+        transpose,          ///< Mirror along the top-left to bottom-right diagonal.
+        rotate_90,          ///< Rotate clockwise.
+        rotate_180,
+        rotate_270,         ///< Rotate counter-clockwise.
+        AMOUNT
+    };
+
+    /**
+     *  @brief  The LosslessTransformer class
+     *          Used to flip, rotate, transpose or crop an image that was encoded by the ImageEncoder class,
+     *          without decoding it to pixels: every Block is moved to its new position, and its quantised
+     *          coefficients are reordered and negated the way the DCT of the flipped pixels would be.
+     *          No DCT or iDCT is performed, so the result has exactly the same quality.
+     */
+    class LosslessTransformer : public ImageProcessor {
+        private:
+            dc::Orientation orientation;    ///< The orientation change to apply.
+            dc::TileRect crop;              ///< The region to keep in the changed orientation (width 0: everything).
+
+            template<size_t bsize>
+            bool processBlocks(const dc::TileRect&);
+
+        public:
+            LosslessTransformer(const std::string &source_file, const std::string &dest_file,
+                                const dc::Orientation &orientation, const dc::TileRect &crop);
+            ~LosslessTransformer(void);
+
+            bool process(void);
+            void saveResult(void) const;
+
+            static dc::Orientation ParseOrientation(const std::string&);
+    };
+}
+
+#endif // LOSSLESSTRANSFORMER_HPP
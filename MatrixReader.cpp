@@ -3,6 +3,7 @@
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <algorithm>
 
 #include "utils.hpp"
 #include "Exceptions.hpp"
@@ -10,26 +11,45 @@
 /**
  *  @brief  Private ctor to build a matrix from an existing stream.
  *  @param  matrix
+ *  @param  size
  */
-template<size_t size>
-dc::MatrixReader<size>::MatrixReader(uint32_t *matrix) {
+template<size_t max_size>
+dc::MatrixReader<max_size>::MatrixReader(uint32_t *matrix, size_t size)
+    : matrix{0}, expanded{0.0}, zigzag{0.0}, size(size)
+{
     std::copy_n(matrix, size * size, this->matrix);
-    std::copy_n(matrix, size * size, this->expanded);
+    this->updateData();
 }
 
 /**
  *  @brief  Default ctor.
  */
-template<size_t size>
-dc::MatrixReader<size>::MatrixReader() : matrix{0}, expanded{0.0} {
+template<size_t max_size>
+dc::MatrixReader<max_size>::MatrixReader() : matrix{0}, expanded{0.0}, zigzag{0.0}, size(dc::BlockSize) {
 
 }
 
+/**
+ *  @brief  Update the double matrices from this->matrix after it changed.
+ */
+template<size_t max_size>
+void dc::MatrixReader<max_size>::updateData(void) {
+    std::copy_n(this->matrix, this->size * this->size, this->expanded);
+
+    dc::dispatchBlockSize(this->size, [&](auto bsize) {
+        constexpr size_t bs = decltype(bsize)::value;
+
+        for (size_t i = 0; i < bs * bs; i++) {
+            this->zigzag[i] = this->expanded[algo::ZigZagLUT<bs>[i]];
+        }
+    });
+}
+
 /**
  *  @brief  Default dtor.
  */
-template<size_t size>
-dc::MatrixReader<size>::~MatrixReader() {
+template<size_t max_size>
+dc::MatrixReader<max_size>::~MatrixReader() {
 
 }
 
@@ -41,11 +61,18 @@ dc::MatrixReader<size>::~MatrixReader() {
  *      The BitStreamReader to read from.
  *  @return
  *      Returns an initialized MatrixReader instance.
+ *      If the stored size is not supported, the size will be 0.
  */
-template<size_t size>
-dc::MatrixReader<> dc::MatrixReader<size>::fromBitstream(util::BitStreamReader &reader) {
+template<size_t max_size>
+dc::MatrixReader<> dc::MatrixReader<max_size>::fromBitstream(util::BitStreamReader &reader) {
+    const size_t   size     = reader.get(dc::MatrixReader<>::BLOCK_SIZE_BITS);
     const uint32_t bit_size = reader.get(dc::MatrixReader<>::SIZE_LEN_BITS);
-    uint32_t matrix[size * size] = { 0u };
+    uint32_t matrix[max_size * max_size] = { 0u };
+
+    if (!dc::isSupportedBlockSize(size) || size > max_size) {
+        std::cerr << "[MatrixReader] Unsupported block size in stream: " << size << "!" << std::endl;
+        return dc::MatrixReader<>(matrix, 0);
+    }
 
     for (size_t y = 0; y < size; y++) {
         for (size_t x = 0; x < size; x++) {
@@ -53,17 +80,20 @@ dc::MatrixReader<> dc::MatrixReader<size>::fromBitstream(util::BitStreamReader &
         }
     }
 
-    return dc::MatrixReader<>(matrix);
+    return dc::MatrixReader<>(matrix, size);
 }
 
 /**
  *  @brief  Read the matrix contents from a text file located at fileName.
  *          Every number in the matrix should fit in a uint16_t.
+ *
+ *          The amount of rows determines the size of the matrix (and the Block size),
+ *          every row should have as many columns as there are rows.
  *  @param  fileName
  *  @return
  */
-template<size_t size>
-bool dc::MatrixReader<size>::read(const std::string &fileName) {
+template<size_t max_size>
+bool dc::MatrixReader<max_size>::read(const std::string &fileName) {
     const std::string *data = nullptr;
 
     try {
@@ -76,32 +106,44 @@ bool dc::MatrixReader<size>::read(const std::string &fileName) {
 
     std::string line, item;
     std::stringstream ss(*data);
+    std::vector<std::string> lines;
     bool exception = false;
     size_t file_row, file_col;
 
-    for (file_row = 0; std::getline(ss, line) && !exception; ++file_row) {
-        if (file_row >= size) {
-            std::cerr << "[MatrixReader] Too many rows in matrix! Expected "
-                      << size << " but got " << file_row << " or more!" << std::endl;
-            exception = true;
-            break;
+    // Gather non-empty rows to determine the matrix size
+    while (std::getline(ss, line)) {
+        std::trim(line);
+
+        if (line.length() > 0) {
+            lines.push_back(line);
         }
+    }
 
-        std::trim(line);
+    this->size = lines.size();
+
+    if (!dc::isSupportedBlockSize(this->size) || this->size > max_size) {
+        std::cerr << "[MatrixReader] Unsupported matrix size! Expected 4, 8 or 16 rows"
+                  << " but got " << this->size << "!" << std::endl;
+        util::deallocVar(data);
+        return false;
+    }
+
+    for (file_row = 0; file_row < this->size && !exception; ++file_row) {
+        line = lines[file_row];
         std::strReplaceConsecutive(line, ' ');
 
         std::stringstream iss(line);
 
         for (file_col = 0; std::getline(iss, item, ' '); ++file_col) {
-            if (file_col >= size) {
+            if (file_col >= this->size) {
                 std::cerr << "[MatrixReader] Too many cols in matrix! Expected "
-                          << size << " but got " << file_col << " or more!" << std::endl;
+                          << this->size << " but got " << file_col << " or more!" << std::endl;
                 exception = true;
                 break;
             }
 
             try {
-                this->matrix[file_row * size + file_col] = util::lexical_cast<uint16_t>(item.c_str());
+                this->matrix[file_row * this->size + file_col] = util::lexical_cast<uint16_t>(item.c_str());
                 //printf("Var => %s \tcast = %d\n", item.c_str(), this->matrix[file_row][file_col]);
             } catch (Exceptions::CastingException const& e) {
                 exception = true;
@@ -110,22 +152,16 @@ bool dc::MatrixReader<size>::read(const std::string &fileName) {
             }
         }
 
-        if (file_col < size) {
+        if (!exception && file_col < this->size) {
             std::cerr << "[MatrixReader] Too little cols in matrix! Expected "
-                      << size << " but got " << file_col << "!" << std::endl;
+                      << this->size << " but got " << file_col << "!" << std::endl;
             exception = true;
             break;
         }
     }
 
-    if (!exception && (file_row < size)) {
-        std::cerr << "[MatrixReader] Too little rows in matrix! Expected "
-                  << size << " but got " << file_row << "!" << std::endl;
-        exception = true;
-    }
-
     if (!exception) {
-        std::copy_n(this->matrix, size * size, this->expanded);
+        this->updateData();
     }
 
     util::deallocVar(data);
@@ -135,39 +171,56 @@ bool dc::MatrixReader<size>::read(const std::string &fileName) {
 
 /**
  *  @brief  Write the matrix to the given BitStreamWriter with a minimal amount of bits.
- *          Use dc::MatrixReader<>::SIZE_LEN_BITS bits to save the bit length and
+ *          Use dc::MatrixReader<>::BLOCK_SIZE_BITS bits to save the matrix size,
+ *          dc::MatrixReader<>::SIZE_LEN_BITS bits to save the bit length and
  *          write size*size values of this->getMaxBitLength() bits to the stream.
  *
  *  @param  writer
  *      The bitstream to write to.
  */
-template<size_t size>
-void dc::MatrixReader<size>::write(util::BitStreamWriter &writer) const {
+template<size_t max_size>
+void dc::MatrixReader<max_size>::write(util::BitStreamWriter &writer) const {
     const uint8_t quant_bit_len = this->getMaxBitLength();
 
     // Assert that quant_bit_len actually fits in dc::MatrixReader<>::SIZE_LEN_BITS bits
     assert((quant_bit_len & ((1 << dc::MatrixReader<>::SIZE_LEN_BITS) - 1))
            == quant_bit_len);
 
+    writer.put(dc::MatrixReader<>::BLOCK_SIZE_BITS, uint32_t(this->size));
     writer.put(dc::MatrixReader<>::SIZE_LEN_BITS, quant_bit_len);
-    for (size_t y = 0; y < size; y++) {
-        for (size_t x = 0; x < size; x++) {
-            writer.put(quant_bit_len, this->matrix[y * size + x]);
+    for (size_t y = 0; y < this->size; y++) {
+        for (size_t x = 0; x < this->size; x++) {
+            writer.put(quant_bit_len, this->matrix[y * this->size + x]);
         }
     }
 }
 
+/**
+ *  @brief  Swap the rows and columns of the matrix,
+ *          for coefficients that were transposed (see LosslessTransformer).
+ */
+template<size_t max_size>
+void dc::MatrixReader<max_size>::transpose(void) {
+    for (size_t y = 0; y < this->size; y++) {
+        for (size_t x = y + 1u; x < this->size; x++) {
+            std::swap(this->matrix[y * this->size + x], this->matrix[x * this->size + y]);
+        }
+    }
+
+    this->updateData();
+}
+
 /**
  *  @brief  Return a string representation for the matrix.
  */
-template<size_t size>
-const std::string dc::MatrixReader<size>::toString(void) const {
+template<size_t max_size>
+const std::string dc::MatrixReader<max_size>::toString(void) const {
     size_t row, col;
     std::ostringstream oss;
 
-    for (row = 0; row < size; row++) {
-        for (col = 0; col < size; col++) {
-            oss << std::setw(4) << this->matrix[row * size + col];
+    for (row = 0; row < this->size; row++) {
+        for (col = 0; col < this->size; col++) {
+            oss << std::setw(4) << this->matrix[row * this->size + col];
         }
         oss << std::endl;
     }
@@ -178,11 +231,11 @@ const std::string dc::MatrixReader<size>::toString(void) const {
 /**
  *  @brief  Get the minimal amount of bits needed to represent every matrix element.
  */
-template<size_t size>
-uint8_t dc::MatrixReader<size>::getMaxBitLength(void) const {
+template<size_t max_size>
+uint8_t dc::MatrixReader<max_size>::getMaxBitLength(void) const {
     uint8_t length = 0u;
 
-    for (size_t i = 0; i < size * size; i++) {
+    for (size_t i = 0; i < this->size * this->size; i++) {
         length = std::max(length, util::ffs(this->matrix[i]));
     }
 
@@ -192,9 +245,44 @@ uint8_t dc::MatrixReader<size>::getMaxBitLength(void) const {
 /**
  *  @brief  Get the internal double matrix.
  */
-template<size_t size>
-const double* dc::MatrixReader<size>::getData() const {
+template<size_t max_size>
+const double* dc::MatrixReader<max_size>::getData() const {
     return this->expanded;
 }
 
-template class dc::MatrixReader<dc::BlockSize>;
+/**
+ *  @brief  Get the internal double matrix in zig-zag order,
+ *          in the same order as the quantised coefficients of a Block.
+ */
+template<size_t max_size>
+const double* dc::MatrixReader<max_size>::getZigzagData() const {
+    return this->zigzag;
+}
+
+/**
+ *  @brief  Resample the matrix to another Block size, for images with adaptive Block sizes.
+ *          Every coefficient takes the value at the same relative frequency in this matrix
+ *          (nearest neighbour). Since the DCT is orthonormal, the same quantization step
+ *          gives the same error per pixel for any Block size.
+ *
+ *  @param  size
+ *      The Block size to resample to.
+ *  @param  data
+ *      The output in zig-zag order, with at least (size*size) elements.
+ */
+template<size_t max_size>
+void dc::MatrixReader<max_size>::getResampledZigzagData(const size_t size, double data[]) const {
+    dc::dispatchBlockSize(size, [&](auto bsize) {
+        constexpr size_t bs = decltype(bsize)::value;
+
+        for (size_t i = 0; i < bs * bs; i++) {
+            const size_t x = algo::ZigZagLUT<bs>[i] % bs;
+            const size_t y = algo::ZigZagLUT<bs>[i] / bs;
+
+            data[i] = this->expanded[((y * this->size) / bs) * this->size
+                                   + ((x * this->size) / bs)];
+        }
+    });
+}
+
+template class dc::MatrixReader<dc::MaxBlockSize>;
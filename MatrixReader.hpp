@@ -10,16 +10,21 @@
 
 namespace dc {
     /**
-     *  A class to read a matrix of size <size>*<size> from a text file.
+     *  A class to read a square matrix of at most <max_size>*<max_size> from a text file.
+     *  The actual size is determined by the file contents (or the bitstream header)
+     *  and decides which Block size is used for en/decoding.
      */
-    template<size_t size = dc::BlockSize>
+    template<size_t max_size = dc::MaxBlockSize>
     class MatrixReader {
         private:
-            uint16_t matrix  [size * size];
-            double   expanded[size * size];
+            uint16_t matrix  [max_size * max_size];
+            double   expanded[max_size * max_size];
+            double   zigzag  [max_size * max_size];   ///< expanded in zig-zag order.
+            size_t   size;
             std::string m_errStr;
 
-            MatrixReader(uint32_t *matrix);
+            MatrixReader(uint32_t *matrix, size_t size);
+            void updateData(void);
 
         public:
             MatrixReader(void);
@@ -28,15 +33,26 @@ namespace dc {
             static MatrixReader<> fromBitstream(util::BitStreamReader &reader);
             bool read(const std::string &fileName);
             void write(util::BitStreamWriter &writer) const;
+            void transpose(void);
             const std::string toString(void) const;
 
             uint8_t getMaxBitLength(void) const;
             const double* getData(void) const;
-
-            static constexpr size_t SIZE_LEN_BITS = 5;
+            const double* getZigzagData(void) const;
+            void getResampledZigzagData(const size_t size, double data[]) const;
+
+            /**
+             *  @brief  Get the width and height of the matrix, which is also the Block size.
+             */
+            inline size_t getSize(void) const {
+                return this->size;
+            }
+
+            static constexpr size_t BLOCK_SIZE_BITS = 5;    ///< The amount of bits to represent the matrix (and Block) size.
+            static constexpr size_t SIZE_LEN_BITS   = 5;    ///< The amount of bits to represent the bit length for every element.
     };
 
-    extern template class dc::MatrixReader<dc::BlockSize>;
+    extern template class dc::MatrixReader<dc::MaxBlockSize>;
 }
 
 #endif // MATRIXREADER_HPP
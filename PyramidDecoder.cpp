@@ -0,0 +1,87 @@
+#include "PyramidDecoder.hpp"
+#include "PyramidEncoder.hpp"
+#include "main.hpp"
+#include "Logger.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <functional>
+
+/**
+ *  @brief  Default ctor, reads the settings header of the container.
+ *
+ *  @param  source_file
+ *      Path to a pyramid container.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ */
+dc::PyramidDecoder::PyramidDecoder(const std::string &source_file, const std::string &dest_file)
+    : ImageBase(source_file, 0u, 0u)
+    , offsets(1u, 0u)
+    , data_start(0u)
+    , dest_file(dest_file)
+    , decoder(nullptr)
+{
+    const size_t levels = std::max<size_t>(1u, this->reader->get(dc::PyramidEncoder::LEVEL_BITS));
+
+    this->offsets.resize(levels);
+
+    // The first level starts right after the header
+    std::vector<size_t> level_offsets(levels - 1u);
+    ImageProcessor::readOffsets(*this->reader, level_offsets);
+    std::copy(level_offsets.begin(), level_offsets.end(), this->offsets.begin() + 1);
+
+    this->data_start = util::round_to_byte(this->reader->get_position());
+
+    util::Logger::WriteLn(std::string_format("[PyramidDecoder] Loaded container with %d levels and %.1f bytes data.",
+                                             levels, float(this->raw_size - this->data_start)));
+}
+
+/**
+ *  @brief  Default dtor
+ */
+dc::PyramidDecoder::~PyramidDecoder(void) {
+    util::deallocVar(this->decoder);
+}
+
+/**
+ *  @brief  Decode a single level of the container.
+ *
+ *  @param  level
+ *      The level to decode, 0 is the full resolution, every next level halves the width and height.
+ *  @return Returns true on success.
+ */
+bool dc::PyramidDecoder::process(const size_t level) {
+    if (level >= this->getLevelCount()) {
+        util::Logger::WriteLn(std::string_format("[PyramidDecoder] Level %d is not in the container (%d levels)!",
+                                                 level, this->getLevelCount()));
+        return false;
+    }
+
+    const size_t begin = this->data_start + this->offsets[level];
+    const size_t end   = (level + 1u < this->getLevelCount())
+                       ? this->data_start + this->offsets[level + 1u]
+                       : this->raw_size;
+
+    if (begin >= end || end > this->raw_size) {
+        util::Logger::WriteLn(std::string_format("[PyramidDecoder] Level %d has an invalid offset!", level));
+        return false;
+    }
+
+    util::Logger::WriteLn(std::string_format("[PyramidDecoder] Decoding level %d (%d bytes)...", level, end - begin));
+
+    // allocVar copies its arguments, the decoder keeps a reference to the path
+    util::deallocVar(this->decoder);
+    this->decoder = util::allocVar<dc::ImageDecoder>(this->raw + begin, end - begin, std::cref(this->dest_file));
+
+    return this->decoder->process();
+}
+
+/**
+ *  @brief  Save the decoded level to the destination file.
+ */
+void dc::PyramidDecoder::saveResult(void) const {
+    if (this->decoder != nullptr) {
+        this->decoder->saveResult();
+    }
+}
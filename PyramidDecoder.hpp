@@ -0,0 +1,38 @@
+#ifndef PYRAMIDDECODER_HPP
+#define PYRAMIDDECODER_HPP
+
+#include "ImageBase.hpp"
+#include "ImageDecoder.hpp"
+
+namespace dc {
+    /**
+     *  @brief  The PyramidDecoder class
+     *          Used to decode one level of a container that was encoded by the PyramidEncoder class.
+     *          Only the bytes of that level are decoded, by an ImageDecoder.
+     */
+    class PyramidDecoder : protected ImageBase {
+        private:
+            std::vector<size_t> offsets;    ///< Byte offset of every level, relative to the start of the first level.
+            size_t data_start;              ///< Byte position of the first level in the container.
+
+            const std::string &dest_file;   ///< The path to the destination file.
+
+            dc::ImageDecoder *decoder;      ///< The decoder for the selected level.
+
+        public:
+            PyramidDecoder(const std::string &source_file, const std::string &dest_file);
+            ~PyramidDecoder(void);
+
+            /**
+             *  @brief  Get the amount of levels in the container, level 0 has the full resolution.
+             */
+            inline size_t getLevelCount(void) const {
+                return this->offsets.size();
+            }
+
+            bool process(const size_t);
+            void saveResult(void) const;
+    };
+}
+
+#endif // PYRAMIDDECODER_HPP
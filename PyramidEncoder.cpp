@@ -0,0 +1,224 @@
+#include "PyramidEncoder.hpp"
+#include "ImageEncoder.hpp"
+#include "main.hpp"
+#include "Logger.hpp"
+#include "utils.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+/**
+ *  @brief  Default ctor
+ *
+ *  @param  source_file
+ *      Path to a raw image file.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ *  @param  width
+ *  @param  height
+ *  @param  use_rle
+ *  @param  quant_m
+ *  @param  levels
+ *      The amount of levels to encode, including the full resolution (at most MAX_LEVELS).
+ *      Less levels are encoded if the dimensions of the next level are not a multiple of the Block size.
+ *  @param  adaptive
+ *  @param  index_interval
+ *  @param  tile_size
+ *  @param  progressive
+ *  @param  dedup
+ *      Layout settings for every level, see ImageEncoder.
+ */
+dc::PyramidEncoder::PyramidEncoder(const std::string &source_file, const std::string &dest_file,
+                                   const uint32_t &width, const uint32_t &height, const bool &use_rle,
+                                   MatrixReader<> &quant_m, const uint16_t &levels, const bool &adaptive,
+                                   const uint32_t &index_interval, const uint32_t &tile_size,
+                                   const bool &progressive, const uint8_t &dedup)
+    : ImageProcessor(source_file, dest_file, width, height, use_rle, quant_m)
+    , levels(std::clamp<size_t>(levels, 1u, dc::PyramidEncoder::MAX_LEVELS))
+    , layout_adaptive(adaptive)
+    , layout_index_interval(index_interval)
+    , layout_tile_size(tile_size)
+    , layout_progressive(progressive)
+    , layout_dedup(dedup)
+{
+    assert(this->width  % this->getBlockSize() == 0);
+    assert(this->height % this->getBlockSize() == 0);
+    assert(this->reader->get_size() == size_t(this->width) * this->height);
+}
+
+/**
+ *  @brief  Default dtor
+ */
+dc::PyramidEncoder::~PyramidEncoder(void) {
+    // Empty
+}
+
+/**
+ *  @brief  Downsample a plane to half its width and height,
+ *          every pixel is the rounded mean of a 2x2 box. Uses SSE2 for 16 pixels at a time if available.
+ *
+ *  @param  src
+ *      The (width*height) source pixels.
+ *  @param  width
+ *      The width of the source, a multiple of 2.
+ *  @param  height
+ *      The height of the source, a multiple of 2.
+ *  @param  dst
+ *      The (width/2*height/2) destination pixels.
+ */
+void dc::PyramidEncoder::Downsample2x2(const uint8_t * const src, const size_t width, const size_t height,
+                                       uint8_t * const dst)
+{
+    const size_t out_width  = width  / 2u;
+    const size_t out_height = height / 2u;
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for schedule(static)
+    #endif
+    for (size_t y = 0; y < out_height; y++) {
+        const uint8_t *row0 = src + 2u * y * width;
+        const uint8_t *row1 = row0 + width;
+              uint8_t *out  = dst + y * out_width;
+        size_t x = 0;
+
+        #ifdef __SSE2__
+            const __m128i even  = _mm_set1_epi16(0x00FF);
+            const __m128i round = _mm_set1_epi16(2);
+
+            for (; x + 16u <= out_width; x += 16u) {
+                const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2u * x));
+                const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2u * x + 16u));
+                const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2u * x));
+                const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2u * x + 16u));
+
+                // Sum of the even and odd pixel of both rows in 16 bits, for 8 output pixels each
+                __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, even), _mm_srli_epi16(a0, 8)),
+                                           _mm_add_epi16(_mm_and_si128(b0, even), _mm_srli_epi16(b0, 8)));
+                __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, even), _mm_srli_epi16(a1, 8)),
+                                           _mm_add_epi16(_mm_and_si128(b1, even), _mm_srli_epi16(b1, 8)));
+
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 2);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 2);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(lo, hi));
+            }
+        #endif
+
+        for (; x < out_width; x++) {
+            out[x] = uint8_t((row0[2u * x] + row0[2u * x + 1u] + row1[2u * x] + row1[2u * x + 1u] + 2u) >> 2);
+        }
+    }
+}
+
+/**
+ *  @brief  Process the raw image for encoding as a pyramid.
+ *
+ *          1. Downsample every level from the previous one (the first level is the raw image)
+ *          2. Encode every level with an ImageEncoder, each one uses the parallel Block loops
+ *          3. Write the header (amount of levels, byte offset of every level after the first)
+ *             and copy the encoded levels behind it
+ *
+ *  @return Returns true on success.
+ */
+bool dc::PyramidEncoder::process(void) {
+    util::Logger::WriteLn("[PyramidEncoder] Processing image...");
+
+    // Every level needs whole Blocks
+    std::vector<uint8_t*> planes { this->raw };
+    std::vector<size_t>   widths { this->width }, heights { this->height };
+
+    while (planes.size() < this->levels
+           && (widths.back()  / 2u) % this->getBlockSize() == 0u && widths.back()  / 2u != 0u
+           && (heights.back() / 2u) % this->getBlockSize() == 0u && heights.back() / 2u != 0u)
+    {
+        const size_t w = widths.back() / 2u, h = heights.back() / 2u;
+        uint8_t *plane = util::allocPlane<uint8_t>(w * h, util::PLANE_UNINITIALISED);
+
+        dc::PyramidEncoder::Downsample2x2(planes.back(), widths.back(), heights.back(), plane);
+
+        planes.push_back(plane);
+        widths.push_back(w);
+        heights.push_back(h);
+    }
+
+    if (planes.size() != this->levels) {
+        util::Logger::WriteLn(std::string_format("[PyramidEncoder] %d levels requested, %d levels fit the Block size.",
+                                                 this->levels, planes.size()));
+    }
+
+    // Encode every level, the byte offsets are relative to the start of the first level
+    std::vector<dc::ImageEncoder*> encoders;
+    std::vector<size_t> offsets;
+    size_t total_length = 0u;
+    bool success = true;
+
+    for (size_t l = 0; l < planes.size() && success; l++) {
+        util::Logger::WriteLn(std::string_format("[PyramidEncoder] Encoding level %d (%dx%d)...",
+                                                 l, widths[l], heights[l]));
+
+        // allocVar copies its arguments, the encoder keeps a reference to the matrix
+        dc::ImageEncoder *enc = util::allocVar<dc::ImageEncoder>(planes[l], uint32_t(widths[l]), uint32_t(heights[l]),
+                                                                 this->use_rle, std::ref(this->quant_m),
+                                                                 this->layout_adaptive, this->layout_index_interval,
+                                                                 this->layout_tile_size, this->layout_progressive,
+                                                                 this->layout_dedup);
+        success = enc->process();
+        encoders.push_back(enc);
+
+        if (l != 0u) {
+            offsets.push_back(total_length);
+        }
+
+        total_length += enc->getStream().get_last_byte_position();
+    }
+
+    if (success) {
+        const size_t header_length = util::round_to_byte(dc::PyramidEncoder::LEVEL_BITS
+                                                         + ImageProcessor::getOffsetsLength(offsets));
+
+        util::deallocVar(this->writer);
+        this->writer = util::allocVar<util::BitStreamWriter>(header_length + total_length);
+        this->writer->put(dc::PyramidEncoder::LEVEL_BITS, uint32_t(planes.size()));
+        ImageProcessor::writeOffsets(*this->writer, offsets);
+
+        uint8_t *data = this->writer->get_buffer() + header_length;
+
+        for (const dc::ImageEncoder *enc : encoders) {
+            const size_t length = enc->getStream().get_last_byte_position();
+
+            std::memcpy(data, enc->getStream().get_buffer(), length);
+            data += length;
+        }
+
+        this->writer->set_position((header_length + total_length) * 8u);
+
+        util::Logger::WriteLn(std::string_format("[PyramidEncoder] %d levels, %d bytes header and %d bytes data.",
+                                                 planes.size(), header_length, total_length));
+    } else {
+        util::Logger::WriteLn("[PyramidEncoder] Error encoding a level!");
+    }
+
+    for (dc::ImageEncoder *enc : encoders) {
+        util::deallocVar(enc);
+    }
+
+    // The first plane is the raw image
+    for (size_t l = 1; l < planes.size(); l++) {
+        util::deallocPlane(planes[l]);
+    }
+
+    return success;
+}
+
+/**
+ *  @brief  Save the container to the destination file.
+ */
+void dc::PyramidEncoder::saveResult(void) const {
+    ImageProcessor::saveResult(true);
+}
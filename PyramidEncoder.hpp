@@ -0,0 +1,43 @@
+#ifndef PYRAMIDENCODER_HPP
+#define PYRAMIDENCODER_HPP
+
+#include "ImageBase.hpp"
+#include "MatrixReader.hpp"
+
+namespace dc {
+    /**
+     *  @brief  The PyramidEncoder class
+     *          Used to encode a raw image at full, 1/2, 1/4, ... resolution into one container.
+     *          The raw image is read once, every level is the 2x2 box downsample of the previous one.
+     *
+     *          The container has a settings header (the amount of levels and an offset table),
+     *          followed by every level as a regular encoded image, see PyramidDecoder.
+     */
+    class PyramidEncoder : public ImageProcessor {
+        private:
+            size_t   levels;            ///< The requested amount of levels, including the full resolution.
+            bool     layout_adaptive;   ///< Layout settings for every level, see ImageEncoder.
+            uint32_t layout_index_interval;
+            uint32_t layout_tile_size;
+            bool     layout_progressive;
+            uint8_t  layout_dedup;
+
+        public:
+            PyramidEncoder(const std::string &source_file, const std::string &dest_file,
+                           const uint32_t &width, const uint32_t &height, const bool &use_rle,
+                           MatrixReader<> &m, const uint16_t &levels, const bool &adaptive = false,
+                           const uint32_t &index_interval = 0u, const uint32_t &tile_size = 0u,
+                           const bool &progressive = false, const uint8_t &dedup = 0u);
+            ~PyramidEncoder(void);
+
+            bool process(void);
+            void saveResult(void) const;
+
+            static void Downsample2x2(const uint8_t * const, const size_t, const size_t, uint8_t * const);
+
+            static constexpr size_t LEVEL_BITS = 4u;    ///< The amount of bits to use to represent the amount of levels.
+            static constexpr size_t MAX_LEVELS = (1u << LEVEL_BITS) - 1u;  ///< The maximum amount of levels.
+    };
+}
+
+#endif // PYRAMIDENCODER_HPP
@@ -0,0 +1,166 @@
+#include "StripDecoder.hpp"
+#include "main.hpp"
+#include "Logger.hpp"
+#include "utils.hpp"
+
+#include <cassert>
+#include <algorithm>
+#include <fstream>
+
+/**
+ *  @brief  Default ctor
+ *
+ *  @param  source_file
+ *      Path to an encoded image file.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ *  @param  strip_rows
+ *      The amount of Block rows to reconstruct before writing them to the destination.
+ */
+dc::StripDecoder::StripDecoder(const std::string &source_file, const std::string &dest_file,
+                               const uint16_t &strip_rows)
+    : ImageProcessor(source_file, dest_file)
+    , strip_rows(std::max<size_t>(1u, strip_rows))
+    , total_length(0u)
+{
+    // Decoding info like (this->quant_m, this->use_rle, width, height)
+    // is gathered in the ImageProcessor ctor after Huffman decompress.
+
+    // Verify settings
+    assert(dc::isSupportedBlockSize(this->getBlockSize()));
+    assert(this->width  % this->getBlockSize() == 0);
+    assert(this->height % this->getBlockSize() == 0);
+
+    util::Logger::WriteLn(std::string_format("[StripDecoder] Loaded %dx%d image (%dx%d blocks).",
+                                             this->width, this->height,
+                                             this->getBlockSize(), this->getBlockSize()));
+}
+
+/**
+ *  @brief  Default dtor
+ */
+dc::StripDecoder::~StripDecoder(void) {
+    // Empty
+}
+
+/**
+ *  @brief  Process the image for decoding, strip by strip.
+ *
+ *          Select the Block size from the quantization matrix in the stream
+ *          and call processBlocks() for that size.
+ *          The Blocks of an adaptive partition, a tiled, progressive or deduplicated image
+ *          are not stored in independent rows, so those images are not supported.
+ *
+ *  @return Returns true on success.
+ */
+bool dc::StripDecoder::process(void) {
+    util::Logger::WriteLn("[StripDecoder] Processing image...");
+
+    if (this->adaptive || this->tile_size != 0u || this->progressive || this->deduplicated) {
+        util::Logger::WriteLn("[StripDecoder] Adaptive Block sizes, tiles, progressive and deduplicated images can not be decoded in strips, use the ImageDecoder!");
+        return false;
+    }
+
+    const bool success = dc::dispatchBlockSize(this->getBlockSize(), [this](auto bsize) {
+        return this->processBlocks<decltype(bsize)::value>();
+    });
+
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[StripDecoder] Unsupported block size %d, or the destination could not be written!",
+                                                 this->getBlockSize()));
+    }
+
+    return success;
+}
+
+/**
+ *  @brief  Process the image for decoding with (bsize*bsize) Blocks.
+ *
+ *      For each strip of this->strip_rows Block rows:
+ *          1. Create the Blocks of the strip in the strip buffer
+ *          2. Load the encoded Block data from the stream (in sequence)
+ *          3. Perform iDCT and multiply with the quant_matrix, expand the results to the strip buffer
+ *          4. Write the rows of the strip to the destination file and flush them
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @return Returns true on success.
+ */
+template<size_t bsize>
+bool dc::StripDecoder::processBlocks(void) {
+    const size_t blockx       = this->width / bsize;
+    const size_t strip_height = this->strip_rows * bsize;
+    const size_t strip_count  = (this->height + strip_height - 1u) / strip_height;
+
+    std::ofstream dest(this->dest_file, std::ofstream::binary);
+
+    if (!dest.good()) {
+        util::Logger::WriteLn(Exceptions::FileWriteException(this->dest_file).getMessage());
+        return false;
+    }
+
+    // Buffers for a single strip, reused by every strip
+    uint8_t *strip = util::allocPlane<uint8_t>(this->width * strip_height, util::PLANE_ZEROED);
+    dc::BlockList<bsize> *blocks = util::allocVar<dc::BlockList<bsize>>(blockx * this->strip_rows);
+
+    util::Logger::WriteLn(std::string_format("[StripDecoder] Decoding %d strips of %d rows (%d bytes per strip)...",
+                                             strip_count, strip_height, this->width * strip_height));
+    util::Logger::WriteProgress(0, strip_count);
+
+    bool success = true;
+
+    for (size_t s = 0; s < strip_count && success; s++) {
+        const size_t rows = std::min(strip_height, this->height - s * strip_height);
+
+        blocks->clear();
+
+        for (size_t b_y = 0; b_y < rows / bsize; b_y++) {
+            for (size_t b_x = 0; b_x < blockx; b_x++) {
+                blocks->add(dc::BlockView { strip, this->width, b_x * bsize, b_y * bsize });
+            }
+        }
+
+        // Reading raw must happen in sequence
+        for (Block<bsize>& b : *blocks) {
+            b.loadFromStream(*this->reader, this->use_rle);
+        }
+
+        #ifdef ENABLE_OPENMP
+            #pragma omp parallel for schedule(dynamic)
+        #endif
+        for (auto it = blocks->begin(); it < blocks->end(); it++) {
+            it->processIDCTMulQ(this->quant_m.getZigzagData());
+            it->expand();
+        }
+
+        // Hand the finished rows to the destination right away
+        dest.write(reinterpret_cast<const char*>(strip), std::streamsize(this->width * rows));
+        dest.flush();
+
+        if (!dest.good()) {
+            util::Logger::WriteLn(Exceptions::FileWriteException(this->dest_file).getMessage());
+            success = false;
+        }
+
+        this->total_length += this->width * rows;
+        util::Logger::WriteProgress(s + 1u, strip_count);
+    }
+
+    util::Logger::WriteLn("", false);
+
+    util::deallocVar(blocks);
+    util::deallocPlane(strip);
+
+    return success;
+}
+
+/**
+ *  @brief  Give some stats, the result is already written to the destination.
+ */
+void dc::StripDecoder::saveResult(void) const {
+    util::Logger::WriteLn(std::string_format("[ImageProcessor] Original file size: %8d bytes", this->raw_size));
+    util::Logger::WriteLn(std::string_format("[ImageProcessor]       Decoded size: %8d bytes  => Ratio: %.2f%%",
+                                             this->total_length,
+                                             (float(this->total_length) / this->raw_size * 100)));
+    util::Logger::WriteLn("[ImageProcessor] Saved file at: " + this->dest_file);
+}
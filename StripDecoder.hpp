@@ -0,0 +1,32 @@
+#ifndef STRIPDECODER_HPP
+#define STRIPDECODER_HPP
+
+#include "ImageBase.hpp"
+
+namespace dc {
+    /**
+     *  @brief  The StripDecoder class
+     *          Used to decode images that were encoded by the ImageEncoder or StripEncoder class,
+     *          one strip of Block rows at a time: every strip is reconstructed in a small buffer
+     *          and written to the destination before the next one, so the output needs memory
+     *          for a strip only and a reader on a pipe receives rows right away.
+     */
+    class StripDecoder : public ImageProcessor {
+        private:
+            size_t strip_rows;          ///< The amount of Block rows in a strip.
+            size_t total_length;        ///< The amount of bytes written to the destination.
+
+            template<size_t bsize>
+            bool processBlocks(void);
+
+        public:
+            StripDecoder(const std::string &source_file, const std::string &dest_file,
+                         const uint16_t &strip_rows);
+            ~StripDecoder(void);
+
+            bool process(void);
+            void saveResult(void) const;
+    };
+}
+
+#endif // STRIPDECODER_HPP
@@ -0,0 +1,189 @@
+#include "StripEncoder.hpp"
+#include "main.hpp"
+#include "Logger.hpp"
+#include "utils.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+/**
+ *  @brief  Default ctor
+ *
+ *  @param  source_file
+ *      Path to a raw image file.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ *  @param  width
+ *  @param  height
+ *  @param  use_rle
+ *  @param  quant_m
+ *  @param  strip_rows
+ *      The amount of Block rows to read and encode at a time.
+ */
+dc::StripEncoder::StripEncoder(const std::string &source_file, const std::string &dest_file,
+                               const uint32_t &width, const uint32_t &height, const bool &use_rle,
+                               MatrixReader<> &quant_m, const uint16_t &strip_rows)
+    : ImageProcessor(dest_file, width, height, use_rle, quant_m)
+    , source(source_file, std::ifstream::binary)
+    , strip_rows(std::max<size_t>(1u, strip_rows))
+    , uniform_blocks(0u)
+    , total_length(0u)
+{
+    if (!this->source.good()) {
+        util::Logger::WriteLn(Exceptions::FileReadException(source_file).getMessage());
+        exit(-1);
+    }
+
+    assert(this->width  % this->getBlockSize() == 0);
+    assert(this->height % this->getBlockSize() == 0);
+}
+
+/**
+ *  @brief  Default dtor
+ */
+dc::StripEncoder::~StripEncoder(void) {
+    // Empty
+}
+
+/**
+ *  @brief  Process the raw image for encoding, strip by strip.
+ *
+ *          Select the Block size from the quantization matrix
+ *          and call processBlocks() for that size.
+ *
+ *  @return Returns true on success.
+ */
+bool dc::StripEncoder::process(void) {
+    util::Logger::WriteLn("[StripEncoder] Processing image...");
+
+    const bool success = dc::dispatchBlockSize(this->getBlockSize(), [this](auto bsize) {
+        return this->processBlocks<decltype(bsize)::value>();
+    });
+
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[StripEncoder] Unsupported block size %d, or a file could not be accessed!",
+                                                 this->getBlockSize()));
+    }
+
+    return success;
+}
+
+/**
+ *  @brief  Process the raw image for encoding with (bsize*bsize) Blocks.
+ *
+ *          1. Write header (encoding settings), see ImageProcessor::writeHeader()
+ *      For each strip of this->strip_rows Block rows:
+ *          2. Read the strip from the source file and create its Blocks
+ *          3. Perform DCT and divide with the quant_matrix, create the RLE sequence
+ *          4. Stream the results and write every whole byte to the destination file
+ *
+ *          Huffman encoding needs the entire stream, so it is never applied.
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @return Returns true on success.
+ */
+template<size_t bsize>
+bool dc::StripEncoder::processBlocks(void) {
+    const size_t blockx       = this->width / bsize;
+    const size_t strip_height = this->strip_rows * bsize;
+    const size_t strip_count  = (this->height + strip_height - 1u) / strip_height;
+
+    std::ofstream dest(this->dest_file, std::ofstream::binary);
+
+    if (!dest.good()) {
+        util::Logger::WriteLn(Exceptions::FileWriteException(this->dest_file).getMessage());
+        return false;
+    }
+
+    // Buffers for a single strip, reused by every strip
+    uint8_t *strip = util::allocPlane<uint8_t>(this->width * strip_height, util::PLANE_UNINITIALISED);
+    const size_t strip_blocks = blockx * this->strip_rows;
+    dc::BlockList<bsize> *blocks = util::allocVar<dc::BlockList<bsize>>(strip_blocks);
+
+    this->writer = util::allocVar<util::BitStreamWriter>(util::round_to_byte(1u + this->getHeaderLength()
+                                                                             + strip_blocks * Block<bsize>::MAX_STREAM_BITS) + 1u,
+                                                         util::PLANE_UNINITIALISED);
+
+    this->writer->put_bit(0); // '0': No Huffman sequence present.
+    this->writeHeader(*this->writer);
+
+    util::Logger::WriteLn(std::string_format("[StripEncoder] Encoding %d strips of %d rows (%d bytes per strip)...",
+                                             strip_count, strip_height, this->width * strip_height));
+    util::Logger::WriteProgress(0, strip_count);
+
+    bool success = true;
+
+    for (size_t s = 0; s < strip_count && success; s++) {
+        const size_t rows = std::min(strip_height, this->height - s * strip_height);
+
+        if (!this->source.read(reinterpret_cast<char*>(strip), std::streamsize(this->width * rows))) {
+            util::Logger::WriteLn(Exceptions::FileReadException("source strip " + std::to_string(s)).getMessage());
+            success = false;
+            break;
+        }
+
+        blocks->clear();
+
+        for (size_t b_y = 0; b_y < rows / bsize; b_y++) {
+            for (size_t b_x = 0; b_x < blockx; b_x++) {
+                blocks->add(dc::BlockView { strip, this->width, b_x * bsize, b_y * bsize });
+            }
+        }
+
+        #ifdef ENABLE_OPENMP
+            #pragma omp parallel for schedule(dynamic)
+        #endif
+        for (auto it = blocks->begin(); it < blocks->end(); it++) {
+            if (it->processUniformDivQ(this->quant_m.getZigzagData())) {
+                #ifdef ENABLE_OPENMP
+                    #pragma omp atomic
+                #endif
+                ++this->uniform_blocks;
+            } else {
+                it->processDCTDivQ(this->quant_m.getZigzagData());
+                it->createRLESequence();
+            }
+        }
+
+        ImageProcessor::streamParallel(blocks->size(), Block<bsize>::MAX_STREAM_BITS,
+                                       [&](const size_t i, util::BitStreamWriter &writer) {
+            (*blocks)[i].streamEncoded(writer, this->use_rle);
+        });
+
+        this->total_length += this->writer->get_position() / 8u;
+        this->writer->drain(dest);
+
+        util::Logger::WriteProgress(s + 1u, strip_count);
+    }
+
+    // Last partial byte
+    this->total_length += this->writer->get_last_byte_position();
+    util::write(dest, *this->writer);
+    util::Logger::WriteLn("", false);
+
+    if (!dest.good()) {
+        util::Logger::WriteLn(Exceptions::FileWriteException(this->dest_file).getMessage());
+        success = false;
+    }
+
+    util::deallocVar(blocks);
+    util::deallocPlane(strip);
+
+    return success;
+}
+
+/**
+ *  @brief  Give some compression stats, the result is already written to the destination.
+ */
+void dc::StripEncoder::saveResult(void) const {
+    const size_t raw_size = size_t(this->width) * this->height;
+
+    util::Logger::WriteLn(std::string_format("[StripEncoder] Uniform Blocks (DCT skipped): %d",
+                                             this->uniform_blocks));
+    util::Logger::WriteLn(std::string_format("[ImageProcessor] Original file size: %8d bytes", raw_size));
+    util::Logger::WriteLn(std::string_format("[ImageProcessor]       Encoded size: %8d bytes  => Ratio: %.2f%%",
+                                             this->total_length,
+                                             (float(this->total_length) / raw_size * 100)));
+    util::Logger::WriteLn("[ImageProcessor] Saved file at: " + this->dest_file);
+}
@@ -0,0 +1,38 @@
+#ifndef STRIPENCODER_HPP
+#define STRIPENCODER_HPP
+
+#include <fstream>
+
+#include "ImageBase.hpp"
+#include "MatrixReader.hpp"
+
+namespace dc {
+    /**
+     *  @brief  The StripEncoder class
+     *          Used to encode raw images one strip of Block rows at a time:
+     *          every strip is read, encoded and written to the destination before the next one,
+     *          so memory use depends on the image width only.
+     *          The result is a regular encoded image (without Huffman table) for the ImageDecoder.
+     */
+    class StripEncoder : public ImageProcessor {
+        private:
+            std::ifstream source;       ///< The raw input file, read one strip at a time.
+            size_t strip_rows;          ///< The amount of Block rows in a strip.
+            size_t uniform_blocks;      ///< Amount of Blocks that skipped the DCT (see Block::processUniformDivQ).
+            size_t total_length;        ///< The amount of bytes written to the destination.
+
+            template<size_t bsize>
+            bool processBlocks(void);
+
+        public:
+            StripEncoder(const std::string &source_file, const std::string &dest_file,
+                         const uint32_t &width, const uint32_t &height, const bool &use_rle,
+                         MatrixReader<> &m, const uint16_t &strip_rows);
+            ~StripEncoder(void);
+
+            bool process(void);
+            void saveResult(void) const;
+    };
+}
+
+#endif // STRIPENCODER_HPP
@@ -0,0 +1,190 @@
+#include "Transcoder.hpp"
+#include "main.hpp"
+#include "Logger.hpp"
+#include "utils.hpp"
+
+/**
+ *  @brief  Default ctor, reads the settings header of the encoded image.
+ *
+ *  @param  source_file
+ *      Path to an encoded image file.
+ *  @param  dest_file
+ *      Path to the destination file (path needs to exist, file will be overwritten).
+ *  @param  quant_m
+ *      The new quantization matrix, with the same size as the matrix of the encoded image.
+ */
+dc::Transcoder::Transcoder(const std::string &source_file, const std::string &dest_file, MatrixReader<> &quant_m)
+    : ImageProcessor(source_file, dest_file)
+    , target_m(quant_m)
+{
+    util::Logger::WriteLn(std::string_format("[Transcoder] Loaded %dx%d image (%s blocks) with %.1f bytes.",
+                                             this->width, this->height,
+                                             this->adaptive
+                                                ? "adaptive"
+                                                : std::string_format("%dx%d", this->getBlockSize(), this->getBlockSize()).c_str(),
+                                             float(this->reader->get_size())));
+}
+
+/**
+ *  @brief  Default dtor
+ */
+dc::Transcoder::~Transcoder(void) {
+    // Empty
+}
+
+/**
+ *  @brief  Process the encoded image for requantization.
+ *
+ *          Select the Block size from the quantization matrix in the stream
+ *          and call processBlocks() for that size (or processAdaptive()),
+ *          then apply Huffman encoding on the result (if enabled).
+ *
+ *  @return Returns true on success.
+ */
+bool dc::Transcoder::process(void) {
+    bool success = true;
+
+    util::Logger::WriteLn("[Transcoder] Processing image...");
+
+    // The Block partition is stored in the stream, so the new matrix has to fit it
+    if (this->target_m.getSize() != this->getBlockSize()) {
+        util::Logger::WriteLn(std::string_format("[Transcoder] The new quantization matrix is %dx%d, the image uses %dx%d!",
+                                                 this->target_m.getSize(), this->target_m.getSize(),
+                                                 this->getBlockSize(), this->getBlockSize()));
+        return false;
+    }
+
+    if (this->adaptive) {
+        success = this->processAdaptive();
+    } else {
+        success = dc::dispatchBlockSize(this->getBlockSize(), [this](auto bsize) {
+            return this->processBlocks<decltype(bsize)::value>();
+        });
+    }
+
+    if (!success) {
+        util::Logger::WriteLn(std::string_format("[Transcoder] Unsupported block size %d!",
+                                                 this->getBlockSize()));
+        return false;
+    }
+
+    ImageProcessor::compressStream();
+
+    return success;
+}
+
+/**
+ *  @brief  Requantise the image with (bsize*bsize) Blocks.
+ *
+ *          1. Create Blocks
+ *          2. Load the encoded Block data from the stream, see ImageProcessor::loadBlocks()
+ *      For each Block:
+ *          3. Rescale the coefficients to the new quantization matrix, see Block::requantise()
+ *          4. Create the RLE sequence
+ *          5. Write header (with the new matrix) and stream the results in the layout of the image,
+ *             see ImageProcessor::streamBlocks()
+ *
+ *  @tparam bsize
+ *      The Block size, equal to this->getBlockSize().
+ *  @return Returns true on success.
+ */
+template<size_t bsize>
+bool dc::Transcoder::processBlocks(void) {
+    // Blocks are created from pixels, which are never used here
+    uint8_t *pixels = util::allocPlane<uint8_t>(size_t(this->width) * this->height, util::PLANE_ZEROED);
+    dc::BlockList<bsize> *blocks = ImageProcessor::createBlocks<bsize>(pixels);
+
+    util::Logger::WriteLn("[Transcoder] Loading Blocks...");
+    ImageProcessor::loadBlocks(*blocks);
+
+    util::Logger::WriteLn("[Transcoder] Requantising Blocks...");
+
+    #ifdef ENABLE_OPENMP
+        #pragma omp parallel for schedule(static)
+    #endif
+    for (auto it = blocks->begin(); it < blocks->end(); it++) {
+        it->requantise(this->quant_m.getZigzagData(), this->target_m.getZigzagData());
+        it->createRLESequence();
+    }
+
+    this->quant_m = this->target_m;
+
+    ImageProcessor::streamBlocks(*blocks);
+
+    util::Logger::WriteLn(std::string_format("[Transcoder] Requantised %d Blocks.", blocks->size()));
+
+    util::deallocVar(blocks);
+    util::deallocPlane(pixels);
+
+    return true;
+}
+
+/**
+ *  @brief  Requantise the image with adaptive Block sizes.
+ *
+ *          1. Read the split flags and Blocks of every MacroBlock, in partition order
+ *          2. Rescale the coefficients of all Blocks of every size,
+ *             with the old and new quantization matrix resampled to that size
+ *          3. Write header (with the new matrix) and stream every split flag and Block in partition order,
+ *             see ImageProcessor::streamAdaptive()
+ *
+ *  @return Returns true on success.
+ */
+bool dc::Transcoder::processAdaptive(void) {
+    util::BitStreamReader &reader = *this->reader;
+    const bool use_rle = this->use_rle;
+
+    // Blocks are created from pixels, which are never used here
+    uint8_t *pixels = util::allocPlane<uint8_t>(size_t(this->width) * this->height, util::PLANE_ZEROED);
+
+    // Reading raw must happen in sequence
+    dc::AdaptiveBlocks *adaptive = ImageProcessor::createAdaptiveBlocks(
+        pixels,
+        [&](const dc::PartitionNode&) {
+            return reader.get_bit() != 0;
+        },
+        [&](const dc::PartitionNode &node, dc::AdaptiveBlocks &blocks) {
+            dc::dispatchBlockSize(node.size, [&](auto bsize) {
+                blocks.get<decltype(bsize)::value>()[node.index].loadFromStream(reader, use_rle);
+            });
+        });
+
+    double from[3][dc::MaxBlockSize * dc::MaxBlockSize], to[3][dc::MaxBlockSize * dc::MaxBlockSize];
+    ImageProcessor::getAdaptiveQuantData(from);
+
+    this->quant_m = this->target_m;
+    ImageProcessor::getAdaptiveQuantData(to);
+
+    util::Logger::WriteLn("[Transcoder] Requantising adaptive Blocks...");
+
+    for (size_t q = 0; q < 3u; q++) {
+        dc::dispatchBlockSize(dc::MinBlockSize << q, [&](auto bsize) {
+            dc::BlockList<bsize> &blocks = adaptive->get<decltype(bsize)::value>();
+
+            #ifdef ENABLE_OPENMP
+                #pragma omp parallel for schedule(static)
+            #endif
+            for (auto it = blocks.begin(); it < blocks.end(); it++) {
+                it->requantise(from[q], to[q]);
+                it->createRLESequence();
+            }
+
+            util::Logger::WriteLn(std::string_format("[Transcoder] %2dx%-2d Blocks: %d",
+                                                     bsize(), bsize(), blocks.size()));
+        });
+    }
+
+    ImageProcessor::streamAdaptive(*adaptive);
+
+    util::deallocVar(adaptive);
+    util::deallocPlane(pixels);
+
+    return true;
+}
+
+/**
+ *  @brief  Save the resulting stream to the destination.
+ */
+void dc::Transcoder::saveResult(void) const {
+    ImageProcessor::saveResult(true);
+}
@@ -0,0 +1,32 @@
+#ifndef TRANSCODER_HPP
+#define TRANSCODER_HPP
+
+#include "ImageBase.hpp"
+#include "MatrixReader.hpp"
+
+namespace dc {
+    /**
+     *  @brief  The Transcoder class
+     *          Used to change the quantization matrix of an image that was encoded by the ImageEncoder class,
+     *          without decoding it to pixels: the quantised coefficients are loaded from the stream,
+     *          rescaled from the old to the new quantization matrix and streamed again.
+     *          No DCT or iDCT is performed, and the layout settings of the image are kept.
+     */
+    class Transcoder : public ImageProcessor {
+        private:
+            MatrixReader<> target_m;    ///< The new quantization matrix, its size must be the Block size of the image.
+
+            template<size_t bsize>
+            bool processBlocks(void);
+            bool processAdaptive(void);
+
+        public:
+            Transcoder(const std::string &source_file, const std::string &dest_file, MatrixReader<> &m);
+            ~Transcoder(void);
+
+            bool process(void);
+            void saveResult(void) const;
+    };
+}
+
+#endif // TRANSCODER_HPP
@@ -0,0 +1,778 @@
+#include "Transform.hpp"
+
+#ifndef _USE_MATH_DEFINES
+    #define _USE_MATH_DEFINES
+#endif
+
+#include "utils.hpp"
+#include "Logger.hpp"
+
+#ifdef _MSC_VER
+    // cmath does not seem to exist with MSVC compiler...
+    #include <math.h>
+#else
+    #include <cmath>
+#endif
+
+#include <array>
+#include <algorithm>
+#include <random>
+#include <fstream>
+#include <limits>
+
+/**
+ *  SIMD backends are compiled with function level target attributes,
+ *  so the binary itself does not require the instruction set and
+ *  the backend is only selected if the CPU supports it.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define TRANSFORM_X86_SIMD
+    #include <immintrin.h>
+#endif
+
+static constexpr size_t MAX_SIZE  = 16u;    ///< Largest supported block size.
+static constexpr int    INT_SHIFT = 30;     ///< Fixed point precision of the basis for the integer backend.
+static constexpr int    INT_BITS  = 30;     ///< Magnitude bits of the block mantissas for the integer backend.
+static constexpr int    INT_GUARD = 6;      ///< Low bits of the integer backend results dropped as rounding noise.
+
+/**
+ *  @brief  Get the block size (rows or columns) for a flattened matrix of length len.
+ */
+static inline size_t size_from_len(const size_t len) {
+    switch (len) {
+        case  16u: return  4u;
+        case  64u: return  8u;
+        case 256u: return 16u;
+        default  : return size_t(std::sqrt(len));
+    }
+}
+
+/**
+ *  @brief  Calculate co-facrtor for each element in DCT matrix.
+ *  @param  i
+ *      The row or column to give the factor for.
+ *  @param  size
+ *      The amount of rows or columns in the matrix.
+ *  @return Returns sqrt(1/size) for i == 0, else sqrt(2/size).
+ *          (0.5 and 1/sqrt(2) for size=4 or len=16)
+ */
+static inline double C(const size_t i, const size_t size) {
+    return std::sqrt((i == 0 ? 1.0 : 2.0) / double(size));
+}
+
+////////////////////////////////////////////////////
+///   DCT basis tables
+////////////////////////////////////////////////////
+
+/**
+ *  @brief  Precalculated DCT basis B for one block size,
+ *          so that DCT(X) = B * X * B^T and iDCT(Y) = B^T * Y * B.
+ */
+struct DCTBasis {
+    size_t  size;
+    double  fwd[MAX_SIZE * MAX_SIZE];       ///< B[u][i]
+    double  inv[MAX_SIZE * MAX_SIZE];       ///< B^T
+    int32_t fwd_int[MAX_SIZE * MAX_SIZE];   ///< B scaled by 2^INT_SHIFT
+    int32_t inv_int[MAX_SIZE * MAX_SIZE];   ///< B^T scaled by 2^INT_SHIFT
+};
+
+static DCTBasis create_basis(const size_t size) {
+    DCTBasis b {};
+    b.size = size;
+
+    const double factor = M_PI_2 / double(size);
+
+    for (size_t u = 0; u < size; u++) {
+        for (size_t i = 0; i < size; i++) {
+            const double v = C(u, size) * std::cos(double(2.0 * i + 1.0) * u * factor);
+
+            b.fwd[u * size + i] = v;
+            b.inv[i * size + u] = v;
+            b.fwd_int[u * size + i] = int32_t(std::lround(v * (1 << INT_SHIFT)));
+            b.inv_int[i * size + u] = b.fwd_int[u * size + i];
+        }
+    }
+
+    return b;
+}
+
+/**
+ *  @brief  Get the basis for the given block size (4, 8 or 16).
+ *          The tables are created once, on first use.
+ */
+static const DCTBasis& get_basis(const size_t size) {
+    static const std::array<DCTBasis, 3> bases = {
+        create_basis(4u), create_basis(8u), create_basis(16u)
+    };
+
+    return bases[size == 4u ? 0 : (size == 8u ? 1 : 2)];
+}
+
+////////////////////////////////////////////////////
+///   Reference backend
+////////////////////////////////////////////////////
+
+/**
+ *  @brief  Calculate the Discrete Cosine Transformation for the given flattened matrix of size len.
+ *          Creates a temporary matrix and copies the results to vec after completion.
+ *
+ *          Naive approach from iPython notebook.
+ *
+ *  @param  vec
+ *      The matrix to calculate the DCT for, given as a flattened array of total length len,
+ *      with std::sqrt(len) colums and rows.
+ *  @param  len
+ *      The total length of the given array and the product of the amount of rows and columns.
+ */
+static void referenceDCT(double vec[], const size_t len) {
+    double *temp        = util::allocArray<double>(len);
+    const size_t size   = size_from_len(len);
+    const double factor = M_PI_2 / double(size);
+
+    for (size_t u = 0; u < size; u++) {
+        for (size_t v = 0; v < size; v++) {
+            for (size_t i = 0; i < size; i++) {
+                for (size_t j = 0; j < size; j++) {
+                    temp[u * size + v] += std::cos(double(2.0 * i + 1.0) * u * factor)
+                                        * std::cos(double(2.0 * j + 1.0) * v * factor)
+                                        * vec[i * size + j];
+                }
+            }
+
+            temp[u * size + v] *= C(u, size) * C(v, size);
+        }
+    }
+
+    std::copy_n(temp, len, vec);
+    util::deallocArray(temp);
+}
+
+/**
+ *  @brief  Calculate the inverse Discrete Cosine Transformation for the given flattened matrix of size len.
+ *          Creates a temporary matrix and copies the results to vec after completion.
+ *
+ *  @param  vec
+ *      The matrix to calculate the iDCT for, given as a flattened array of total length len,
+ *      with std::sqrt(len) colums and rows.
+ *  @param  len
+ *      The total length of the given array and the product of the amount of rows and columns.
+ */
+static void referenceDCTinverse(double vec[], const size_t len) {
+    double *temp        = util::allocArray<double>(len);
+    const size_t size   = size_from_len(len);
+    const double factor = M_PI_2 / double(size);
+
+    for (size_t u = 0; u < size; u++) {
+        for (size_t v = 0; v < size; v++) {
+            for (size_t i = 0; i < size; i++) {
+                for (size_t j = 0; j < size; j++) {
+                    temp[i * size + j] += C(u, size) * C(v, size)
+                                        * std::cos(double(2.0 * i + 1.0) * u * factor)
+                                        * std::cos(double(2.0 * j + 1.0) * v * factor)
+                                        * vec[u * size + v];
+                }
+            }
+        }
+    }
+
+    std::copy_n(temp, len, vec);
+    util::deallocArray(temp);
+}
+
+////////////////////////////////////////////////////
+///   Separable backend
+////////////////////////////////////////////////////
+
+/**
+ *  @brief  Matrix product C = A * M for (n*n) matrices.
+ *          Every row of C is a sum of rows of M, scaled by an element of A,
+ *          so the inner loop runs over contiguous memory.
+ */
+static inline void matmul_scalar(const double * const A, const double * const M,
+                                 double * const C, const size_t n)
+{
+    for (size_t u = 0; u < n; u++) {
+        double *c = &C[u * n];
+        std::fill_n(c, n, 0.0);
+
+        for (size_t k = 0; k < n; k++) {
+            const double  a = A[u * n + k];
+            const double *m = &M[k * n];
+
+            for (size_t v = 0; v < n; v++) {
+                c[v] += a * m[v];
+            }
+        }
+    }
+}
+
+/**
+ *  @brief  Row-column DCT with the precalculated basis: B * X * B^T.
+ */
+static void separableDCT(double vec[], const size_t len) {
+    const DCTBasis& b = get_basis(size_from_len(len));
+    double temp[MAX_SIZE * MAX_SIZE];
+
+    matmul_scalar(b.fwd, vec, temp, b.size);
+    matmul_scalar(temp, b.inv, vec, b.size);
+}
+
+/**
+ *  @brief  Row-column iDCT with the precalculated basis: B^T * Y * B.
+ */
+static void separableDCTinverse(double vec[], const size_t len) {
+    const DCTBasis& b = get_basis(size_from_len(len));
+    double temp[MAX_SIZE * MAX_SIZE];
+
+    matmul_scalar(b.inv, vec, temp, b.size);
+    matmul_scalar(temp, b.fwd, vec, b.size);
+}
+
+////////////////////////////////////////////////////
+///   Integer backend
+////////////////////////////////////////////////////
+
+/**
+ *  @brief  Row-column transform in fixed point: A * X * M, with A and M scaled by 2^INT_SHIFT.
+ *          Input values are not always integers (e.g. coefficients scaled for a smaller iDCT,
+ *          or dequantized with a resampled matrix), so the block is converted with a common
+ *          exponent: the largest magnitude gets INT_BITS bits, the rest keeps its fraction.
+ *          The rows of A and M have an L2 norm of 2^INT_SHIFT and n <= 16, so the first pass
+ *          stays below 2^62 and is scaled back to INT_BITS bits (rounded) before the second one,
+ *          which then stays below 2^62 as well.
+ *          The result is rounded to INT_BITS - INT_GUARD bits, well above the rounding error,
+ *          so that exact values (e.g. of a flat block) do not end up just below an integer.
+ */
+static void integer_transform(double vec[], const int32_t * const A, const int32_t * const M, const size_t n) {
+    int64_t x[MAX_SIZE * MAX_SIZE];
+    int64_t t[MAX_SIZE * MAX_SIZE];
+
+    double peak = 0.0;
+
+    for (size_t i = 0; i < n * n; i++) {
+        peak = std::max(peak, std::abs(vec[i]));
+    }
+
+    if (peak == 0.0) {
+        return;
+    }
+
+    // peak < 2^exponent, so the mantissas are at most 2^INT_BITS
+    int exponent;
+    std::frexp(peak, &exponent);
+
+    const int frac = INT_BITS - exponent;
+
+    for (size_t i = 0; i < n * n; i++) {
+        x[i] = std::llround(std::ldexp(vec[i], frac));
+    }
+
+    constexpr int     shift = INT_SHIFT + 2;
+    constexpr int64_t half  = int64_t(1) << (shift - 1);
+    constexpr int     drop  = 2 * INT_SHIFT - shift + INT_GUARD;
+    constexpr int64_t round = int64_t(1) << (drop - 1);
+
+    for (size_t u = 0; u < n; u++) {
+        for (size_t v = 0; v < n; v++) {
+            int64_t sum = 0;
+
+            for (size_t k = 0; k < n; k++) {
+                sum += A[u * n + k] * x[k * n + v];
+            }
+
+            t[u * n + v] = (sum + half) >> shift;
+        }
+    }
+
+    for (size_t u = 0; u < n; u++) {
+        for (size_t v = 0; v < n; v++) {
+            int64_t sum = 0;
+
+            for (size_t k = 0; k < n; k++) {
+                sum += t[u * n + k] * M[k * n + v];
+            }
+
+            vec[u * n + v] = std::ldexp(double((sum + round) >> drop), INT_GUARD - frac);
+        }
+    }
+}
+
+static void integerDCT(double vec[], const size_t len) {
+    const DCTBasis& b = get_basis(size_from_len(len));
+    integer_transform(vec, b.fwd_int, b.inv_int, b.size);
+}
+
+static void integerDCTinverse(double vec[], const size_t len) {
+    const DCTBasis& b = get_basis(size_from_len(len));
+    integer_transform(vec, b.inv_int, b.fwd_int, b.size);
+}
+
+////////////////////////////////////////////////////
+///   SIMD backends
+////////////////////////////////////////////////////
+
+#ifdef TRANSFORM_X86_SIMD
+/**
+ *  @brief  Matrix product C = A * M with 2 doubles per SSE2 register.
+ */
+__attribute__((target("sse2")))
+static void matmul_sse2(const double * const A, const double * const M,
+                        double * const C, const size_t n)
+{
+    for (size_t u = 0; u < n; u++) {
+        for (size_t v = 0; v < n; v += 2) {
+            __m128d acc = _mm_setzero_pd();
+
+            for (size_t k = 0; k < n; k++) {
+                acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(A[u * n + k]),
+                                                 _mm_loadu_pd(&M[k * n + v])));
+            }
+
+            _mm_storeu_pd(&C[u * n + v], acc);
+        }
+    }
+}
+
+/**
+ *  @brief  Matrix product C = A * M with 4 doubles per AVX register.
+ */
+__attribute__((target("avx")))
+static void matmul_avx(const double * const A, const double * const M,
+                       double * const C, const size_t n)
+{
+    for (size_t u = 0; u < n; u++) {
+        for (size_t v = 0; v < n; v += 4) {
+            __m256d acc = _mm256_setzero_pd();
+
+            for (size_t k = 0; k < n; k++) {
+                acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_set1_pd(A[u * n + k]),
+                                                       _mm256_loadu_pd(&M[k * n + v])));
+            }
+
+            _mm256_storeu_pd(&C[u * n + v], acc);
+        }
+    }
+}
+
+static void sse2DCT(double vec[], const size_t len) {
+    const DCTBasis& b = get_basis(size_from_len(len));
+    double temp[MAX_SIZE * MAX_SIZE];
+
+    matmul_sse2(b.fwd, vec, temp, b.size);
+    matmul_sse2(temp, b.inv, vec, b.size);
+}
+
+static void sse2DCTinverse(double vec[], const size_t len) {
+    const DCTBasis& b = get_basis(size_from_len(len));
+    double temp[MAX_SIZE * MAX_SIZE];
+
+    matmul_sse2(b.inv, vec, temp, b.size);
+    matmul_sse2(temp, b.fwd, vec, b.size);
+}
+
+static void avxDCT(double vec[], const size_t len) {
+    const DCTBasis& b = get_basis(size_from_len(len));
+    double temp[MAX_SIZE * MAX_SIZE];
+
+    matmul_avx(b.fwd, vec, temp, b.size);
+    matmul_avx(temp, b.inv, vec, b.size);
+}
+
+static void avxDCTinverse(double vec[], const size_t len) {
+    const DCTBasis& b = get_basis(size_from_len(len));
+    double temp[MAX_SIZE * MAX_SIZE];
+
+    matmul_avx(b.inv, vec, temp, b.size);
+    matmul_avx(temp, b.fwd, vec, b.size);
+}
+#endif
+
+////////////////////////////////////////////////////
+///   Registry
+////////////////////////////////////////////////////
+
+/**
+ *  @brief  Every available transform backend.
+ */
+static const std::vector<algo::TransformBackend> TransformBackends = {
+    { "reference", algo::CPU_NONE, 0u, referenceDCT, referenceDCTinverse },
+    { "integer"  , algo::CPU_NONE, 1u, integerDCT  , integerDCTinverse   },
+    { "separable", algo::CPU_NONE, 2u, separableDCT, separableDCTinverse },
+#ifdef TRANSFORM_X86_SIMD
+    { "sse2"     , algo::CPU_SSE2, 3u, sse2DCT     , sse2DCTinverse      },
+    { "avx"      , algo::CPU_AVX , 4u, avxDCT      , avxDCTinverse       },
+#endif
+};
+
+/**
+ *  @brief  The currently selected backend, set by algo::selectTransformBackend().
+ */
+static const algo::TransformBackend *ActiveBackend = nullptr;
+
+static inline bool is_supported(const algo::TransformBackend& backend, const uint32_t features) {
+    return (backend.features & features) == backend.features;
+}
+
+/**
+ *  @brief  Select the supported backend with the highest priority.
+ */
+static const algo::TransformBackend* select_by_features(const uint32_t features) {
+    const algo::TransformBackend *best = &TransformBackends.front();
+
+    for (const algo::TransformBackend& backend : TransformBackends) {
+        if (is_supported(backend, features) && backend.priority > best->priority) {
+            best = &backend;
+        }
+    }
+
+    return best;
+}
+
+static const algo::TransformBackend* find_backend(const std::string &name) {
+    for (const algo::TransformBackend& backend : TransformBackends) {
+        if (name == backend.name) {
+            return &backend;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ *  @brief  Check the backend against the reference implementation and time it
+ *          on the same amount of pixels for every block size.
+ *
+ *  @return Returns the time in ns for one forward and inverse pass over all test blocks,
+ *          or the max value if the results did not match the reference.
+ */
+static int64_t benchmark_backend(const algo::TransformBackend& backend) {
+    static constexpr size_t PIXELS     = 4096u;  ///< Pixels per block size
+    static constexpr double TOLERANCE  = 0.25;   ///< Max difference with the reference
+    static constexpr int64_t MIN_TIME  = 10000000;  ///< Repeat until at least 10 ms elapsed
+
+    std::mt19937 rng(0x5EED);
+    std::uniform_real_distribution<double> pixel(-128.0, 127.0);
+
+    // Not only integers: inputs can be fractional (scaled or resampled coefficients)
+    std::vector<double> input(PIXELS * 3);
+
+    for (double& v : input) {
+        v = pixel(rng);
+    }
+
+    // Validate
+    for (const size_t size : { 4u, 8u, 16u }) {
+        const size_t len = size * size;
+        double expected[MAX_SIZE * MAX_SIZE], result[MAX_SIZE * MAX_SIZE];
+
+        std::copy_n(input.data(), len, expected);
+        std::copy_n(input.data(), len, result);
+
+        referenceDCT(expected, len);
+        backend.forward(result, len);
+
+        for (size_t i = 0; i < len; i++) {
+            if (std::abs(expected[i] - result[i]) > TOLERANCE) {
+                return std::numeric_limits<int64_t>::max();
+            }
+        }
+
+        // The inverse gets the (fractional) coefficients of the reference
+        std::copy_n(expected, len, result);
+
+        referenceDCTinverse(expected, len);
+        backend.inverse(result, len);
+
+        for (size_t i = 0; i < len; i++) {
+            if (std::abs(expected[i] - result[i]) > TOLERANCE) {
+                return std::numeric_limits<int64_t>::max();
+            }
+        }
+    }
+
+    // Time
+    std::vector<double> work(input);
+    int64_t elapsed = 0;
+    size_t  repeats = 0;
+
+    const util::timepoint_t start = util::TimerStart();
+
+    do {
+        double *data = work.data();
+
+        for (const size_t size : { 4u, 8u, 16u }) {
+            const size_t len = size * size;
+
+            for (size_t b = 0; b < PIXELS / len; b++, data += len) {
+                backend.forward(data, len);
+                backend.inverse(data, len);
+            }
+        }
+
+        repeats++;
+        elapsed = util::TimerDuration_ns(start);
+    } while (elapsed < MIN_TIME);
+
+    return elapsed / int64_t(repeats);
+}
+
+/**
+ *  @brief  Select a backend by self-benchmark.
+ *          The result is cached in algo::TRANSFORM_CACHE together with the CPU features,
+ *          and reused if the features still match.
+ */
+static const algo::TransformBackend* select_by_benchmark(const uint32_t features) {
+    std::ifstream cache_in(algo::TRANSFORM_CACHE);
+
+    if (cache_in.good()) {
+        uint32_t    cached_features = 0u;
+        std::string cached_name;
+
+        if (cache_in >> cached_features >> cached_name && cached_features == features) {
+            const algo::TransformBackend *cached = find_backend(cached_name);
+
+            if (cached != nullptr && is_supported(*cached, features)) {
+                util::Logger::WriteLn(std::string_format("[Transform] Using cached benchmark result from '%s'.",
+                                                         algo::TRANSFORM_CACHE));
+                return cached;
+            }
+        }
+    }
+
+    cache_in.close();
+
+    const algo::TransformBackend *best = select_by_features(features);
+    int64_t best_time = std::numeric_limits<int64_t>::max();
+
+    for (const algo::TransformBackend& backend : TransformBackends) {
+        if (!is_supported(backend, features)) {
+            continue;
+        }
+
+        const int64_t time = benchmark_backend(backend);
+
+        if (time == std::numeric_limits<int64_t>::max()) {
+            util::Logger::WriteLn(std::string_format("[Transform] Backend '%s' does not match the reference, skipped.",
+                                                     backend.name));
+            continue;
+        }
+
+        util::Logger::WriteLn(std::string_format("[Transform] Backend %-10s: %8.1f us",
+                                                 backend.name, double(time) / 1.0e3));
+
+        if (time < best_time) {
+            best      = &backend;
+            best_time = time;
+        }
+    }
+
+    std::ofstream cache_out(algo::TRANSFORM_CACHE);
+
+    if (cache_out.good()) {
+        cache_out << features << " " << best->name << std::endl;
+    }
+
+    return best;
+}
+
+/**
+ *  @brief  Detect the CPU features that are relevant for the transform backends.
+ */
+uint32_t algo::detectCpuFeatures(void) {
+    uint32_t features = algo::CPU_NONE;
+
+    #ifdef TRANSFORM_X86_SIMD
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("sse2")) features |= algo::CPU_SSE2;
+        if (__builtin_cpu_supports("avx"))  features |= algo::CPU_AVX;
+    #endif
+
+    return features;
+}
+
+/**
+ *  @brief  Get the list of every compiled transform backend.
+ */
+const std::vector<algo::TransformBackend>& algo::getTransformBackends(void) {
+    return TransformBackends;
+}
+
+/**
+ *  @brief  Get the selected transform backend.
+ *          If none was selected yet, select one by CPU features.
+ */
+const algo::TransformBackend& algo::getTransformBackend(void) {
+    if (ActiveBackend == nullptr) {
+        ActiveBackend = select_by_features(algo::detectCpuFeatures());
+    }
+
+    return *ActiveBackend;
+}
+
+/**
+ *  @brief  Select the transform backend to use for every DCT.
+ *          Must be called before any Blocks are processed.
+ *
+ *  @param  setting
+ *      algo::TRANSFORM_AUTO (or empty) to select by CPU features,
+ *      algo::TRANSFORM_BENCH to select by (cached) self-benchmark,
+ *      or the name of a backend to force it.
+ *  @return Returns false if the setting was not a known or supported backend,
+ *          a backend will still be selected by CPU features in that case.
+ */
+bool algo::selectTransformBackend(const std::string &setting) {
+    const uint32_t features = algo::detectCpuFeatures();
+    bool success = true;
+
+    if (setting.empty() || setting == algo::TRANSFORM_AUTO) {
+        ActiveBackend = select_by_features(features);
+    } else if (setting == algo::TRANSFORM_BENCH) {
+        ActiveBackend = select_by_benchmark(features);
+    } else {
+        const algo::TransformBackend *backend = find_backend(setting);
+
+        if (backend == nullptr || !is_supported(*backend, features)) {
+            util::Logger::WriteLn(std::string_format("[Transform] Backend '%s' is %s, selecting by CPU features.",
+                                                     setting.c_str(),
+                                                     backend == nullptr ? "unknown" : "not supported on this CPU"));
+            ActiveBackend = select_by_features(features);
+            success = false;
+        } else {
+            ActiveBackend = backend;
+        }
+    }
+
+    util::Logger::WriteLn(std::string_format("[Transform] Using '%s' DCT backend.", ActiveBackend->name));
+
+    return success;
+}
+
+/**
+ *  @brief  Calculate the DCT with the selected backend.
+ *
+ *  @param  vec
+ *      The matrix to calculate the DCT for, given as a flattened array of total length len,
+ *      with std::sqrt(len) colums and rows.
+ *  @param  len
+ *      The total length of the given array (16, 64 or 256).
+ */
+void algo::transformDCT(double vec[], const size_t len) {
+    algo::getTransformBackend().forward(vec, len);
+}
+
+/**
+ *  @brief  Calculate the inverse DCT with the selected backend.
+ *
+ *  @param  vec
+ *      The matrix to calculate the iDCT for, given as a flattened array of total length len,
+ *      with std::sqrt(len) colums and rows.
+ *  @param  len
+ *      The total length of the given array (16, 64 or 256).
+ */
+void algo::transformDCTinverse(double vec[], const size_t len) {
+    algo::getTransformBackend().inverse(vec, len);
+}
+
+/**
+ *  @brief  Calculate the inverse DCT for a block of which only the first coded
+ *          coefficients in zig-zag order can be non-zero (as known from the RLE length).
+ *
+ *          - No coefficients or DC only: every pixel gets the same value.
+ *          - Only the first row (or column) is coded: every row (or column) is the same
+ *            1D inverse transform of it.
+ *          - At most <size> non-zero coefficients: every coefficient adds its scaled
+ *            basis image, which is cheaper than the row-column transform.
+ *          - Else the selected backend is used.
+ *
+ *  @param  vec
+ *      The (dequantized) coefficients, given as a flattened array of total length len.
+ *  @param  len
+ *      The total length of the given array (16, 64 or 256).
+ *  @param  zigzag
+ *      The zig-zag indices for the block size, see algo::ZigZagLUT.
+ *  @param  coded
+ *      The amount of coefficients in zig-zag order that can be non-zero,
+ *      every element after it must be 0.
+ */
+void algo::transformDCTinverseSparse(double vec[], const size_t len, const uint16_t zigzag[], const size_t coded) {
+    const size_t size = size_from_len(len);
+
+    if (coded <= 1u) {
+        std::fill_n(vec, len, vec[0] / double(size));
+        return;
+    }
+
+    bool first_row = true, first_col = true;
+    size_t nonzero = 0u;
+
+    for (size_t i = 0; i < coded; i++) {
+        if (vec[zigzag[i]] != 0.0) {
+            first_row &= (zigzag[i] / size == 0u);
+            first_col &= (zigzag[i] % size == 0u);
+            nonzero++;
+        }
+    }
+
+    const DCTBasis& b = get_basis(size);
+    const double dc_factor = b.fwd[0];  // 1 / sqrt(size)
+    double temp[MAX_SIZE];
+
+    if (first_row) {
+        // X[i][j] = 1/sqrt(size) * sum_v(Y[0][v] * B[v][j]) for every row i
+        for (size_t j = 0; j < size; j++) {
+            double sum = 0.0;
+
+            for (size_t v = 0; v < size; v++) {
+                sum += vec[v] * b.fwd[v * size + j];
+            }
+
+            temp[j] = sum * dc_factor;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            std::copy_n(temp, size, &vec[i * size]);
+        }
+    } else if (first_col) {
+        // X[i][j] = 1/sqrt(size) * sum_u(Y[u][0] * B[u][i]) for every column j
+        for (size_t i = 0; i < size; i++) {
+            double sum = 0.0;
+
+            for (size_t u = 0; u < size; u++) {
+                sum += vec[u * size] * b.fwd[u * size + i];
+            }
+
+            temp[i] = sum * dc_factor;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            std::fill_n(&vec[i * size], size, temp[i]);
+        }
+    } else if (nonzero <= size) {
+        // X[i][j] = sum over non-zero Y[u][v] * B[u][i] * B[v][j]
+        double out[MAX_SIZE * MAX_SIZE] = {0.0};
+
+        for (size_t k = 0; k < coded; k++) {
+            const size_t u = zigzag[k] / size, v = zigzag[k] % size;
+            const double coef = vec[u * size + v];
+
+            if (coef == 0.0) {
+                continue;
+            }
+
+            for (size_t i = 0; i < size; i++) {
+                const double  row_factor = coef * b.fwd[u * size + i];
+                const double *basis_v    = &b.fwd[v * size];
+                double       *out_row    = &out[i * size];
+
+                for (size_t j = 0; j < size; j++) {
+                    out_row[j] += row_factor * basis_v[j];
+                }
+            }
+        }
+
+        std::copy_n(out, len, vec);
+    } else {
+        algo::transformDCTinverse(vec, len);
+    }
+}
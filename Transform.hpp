@@ -0,0 +1,62 @@
+#ifndef TRANSFORM_HPP
+#define TRANSFORM_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "algo.hpp"
+
+namespace algo {
+    /**
+     *  @brief  CPU features a transform backend can require.
+     */
+    enum CpuFeature : uint32_t {
+        CPU_NONE = 0u,
+        CPU_SSE2 = 1u << 0,
+        CPU_AVX  = 1u << 1,
+    };
+
+    /**
+     *  Function type for a 2D DCT on a flattened (size*size) matrix of length len.
+     */
+    typedef void (*transform_fn)(double[], const size_t);
+
+    /**
+     *  @brief  A transform implementation in the registry.
+     *          Every backend calculates the same orthonormal 2D DCT (within rounding),
+     *          so a stream encoded with one backend can be decoded with any other.
+     */
+    struct TransformBackend {
+        const char   *name;       ///< Name to select the backend with in the settings.
+        uint32_t      features;   ///< Required CpuFeature flags.
+        uint8_t       priority;   ///< Preference when auto-selecting (higher is better).
+        transform_fn  forward;    ///< Forward DCT.
+        transform_fn  inverse;    ///< Inverse DCT.
+    };
+
+    uint32_t detectCpuFeatures(void);
+
+    const std::vector<algo::TransformBackend>& getTransformBackends(void);
+    const algo::TransformBackend& getTransformBackend(void);
+    bool selectTransformBackend(const std::string &setting);
+
+    /**
+     *  DCT functions, dispatched to the selected backend.
+     */
+    void transformDCT(double[], const size_t);
+    void transformDCTinverse(double[], const std::size_t);
+
+    /**
+     *  Inverse DCT for blocks with few coded coefficients,
+     *  falls back to the selected backend for dense blocks.
+     */
+    void transformDCTinverseSparse(double[], const size_t, const uint16_t[], const size_t);
+
+    static constexpr const char *TRANSFORM_AUTO  = "auto";    ///< Setting: select by CPU features (default).
+    static constexpr const char *TRANSFORM_BENCH = "bench";   ///< Setting: select by (cached) self-benchmark.
+    static constexpr const char *TRANSFORM_CACHE = "dct_backend.cache";  ///< Benchmark result cache file.
+}
+
+#endif // TRANSFORM_HPP
@@ -3,19 +3,12 @@
 #include "Logger.hpp"
 #include "Huffman.hpp"
 
-dc::VideoBase::VideoBase(const std::string &source_file, const uint16_t &width, const uint16_t &height)
+dc::VideoBase::VideoBase(const std::string &source_file, const uint32_t &width, const uint32_t &height)
     : ImageBase(source_file, width, height)
-    , frame_buffer_size(width * height)
-    , frame_garbage_size(width * height / 2)
+    , frame_buffer_size(size_t(width) * height)
+    , frame_garbage_size(size_t(width) * height / 2)
 {
-    try {
-        this->raw = util::readBinaryFile(source_file);
-    } catch (Exceptions::FileReadException const& e) {
-        util::Logger::WriteLn(e.getMessage());
-        exit(-1);
-    }
-
-    this->reader = util::allocVar<util::BitStreamReader>(this->raw->data(), this->raw->size());
+    // The source file is already read into this->raw by ImageBase
 }
 
 /**
@@ -26,7 +19,7 @@ dc::VideoBase::~VideoBase(void) {
 }
 
 dc::VideoProcessor::VideoProcessor(const std::string &source_file, const std::string &dest_file,
-                                   const uint16_t &width, const uint16_t &height,
+                                   const uint32_t &width, const uint32_t &height,
                                    const bool &use_rle, MatrixReader<> &quant_m,
                                    const uint16_t &gop, const uint16_t &merange)
     : VideoBase(source_file, width, height)
@@ -67,18 +60,20 @@ dc::VideoProcessor::VideoProcessor(const std::string &source_file, const std::st
 
     // Read other settings in same order as they were presumably written to the encoded stream
     this->use_rle = this->reader->get(dc::ImageProcessor::RLE_BITS);
-    this->width   = uint16_t(this->reader->get(dc::ImageProcessor::DIM_BITS));
-    this->height  = uint16_t(this->reader->get(dc::ImageProcessor::DIM_BITS));
+    std::vector<size_t> fields(5u);
+    dc::ImageProcessor::readFields(*this->reader, fields);
+    this->width   = uint32_t(fields[0]);
+    this->height  = uint32_t(fields[1]);
 
-    this->frame_count        = this->reader->get(dc::ImageProcessor::DIM_BITS);
-    this->frame_buffer_size  = this->width * this->height;  // 1 part Y data
+    this->frame_count        = fields[2];
+    this->frame_buffer_size  = size_t(this->width) * this->height;  // 1 part Y data
     this->frame_garbage_size = this->frame_buffer_size / 2; // 0.5 parts UV data
 
     // Decoded frame will be decoded Y data
     //  + this->frame_garbage_size times 0x80 as 'garbage data' for UV components
 
-    this->gop     = uint16_t(this->reader->get(dc::ImageProcessor::DIM_BITS));
-    this->merange = uint16_t(this->reader->get(dc::ImageProcessor::DIM_BITS));
+    this->gop     = uint16_t(fields[3]);
+    this->merange = uint16_t(fields[4]);
 
     dc::Frame::MVEC_BIT_SIZE = util::bits_needed(int16_t(this->merange));
 
@@ -136,10 +131,10 @@ void dc::VideoProcessor::saveResult(bool encoded) const {
         util::write(file, *this->writer);
     #endif
 
-    util::Logger::WriteLn(std::string_format("[VideoProcessor] Original file size: %8d bytes", this->raw->size()));
+    util::Logger::WriteLn(std::string_format("[VideoProcessor] Original file size: %8d bytes", this->raw_size));
     util::Logger::WriteLn(std::string_format("[VideoProcessor]       %scoded size: %8d bytes  => Ratio: %.2f%%",
                                              (encoded ? "En" : "De"),
                                              total_length,
-                                             (float(total_length) / this->raw->size() * 100)));
+                                             (float(total_length) / this->raw_size * 100)));
     util::Logger::WriteLn("[VideoProcessor] Saved file at: " + this->dest_file);
 }
@@ -10,7 +10,7 @@ namespace dc {
             size_t frame_buffer_size;     // Y data size
             size_t frame_garbage_size;    // UV data size (if inlcuded, e.g. only when encoding)
         public:
-            VideoBase(const std::string &source_file, const uint16_t &width, const uint16_t &height);
+            VideoBase(const std::string &source_file, const uint32_t &width, const uint32_t &height);
             ~VideoBase(void);
     };
 
@@ -35,7 +35,7 @@ namespace dc {
             bool process(uint8_t * const);
         public:
             VideoProcessor(const std::string &source_file, const std::string &dest_file,
-                           const uint16_t &width, const uint16_t &height,
+                           const uint32_t &width, const uint32_t &height,
                            const bool &use_rle, MatrixReader<> &quant_m,
                            const uint16_t &gop, const uint16_t &merange);
             VideoProcessor(const std::string &source_file, const std::string &dest_file,
@@ -10,8 +10,9 @@ dc::VideoDecoder::VideoDecoder(const std::string &source_file,
     : VideoProcessor(source_file, dest_file, motioncomp)
 {
     // Verify settings
-    assert(this->width  % dc::BlockSize == 0);
-    assert(this->height % dc::BlockSize == 0);
+    assert(dc::isSupportedBlockSize(this->quant_m.getSize()));
+    assert(this->width  % dc::MacroBlockSize == 0);
+    assert(this->height % dc::MacroBlockSize == 0);
 
     // Same data stats before decoding starts
     const float hdrlen = float(this->reader->get_position()) / 8.0f;
@@ -23,7 +24,8 @@ dc::VideoDecoder::VideoDecoder(const std::string &source_file,
 
     // Create the output buffer
     const size_t total_frame_size = this->frame_buffer_size + this->frame_garbage_size;
-    this->writer = util::allocVar<util::BitStreamWriter>(total_frame_size * this->frame_count);
+    this->writer = util::allocVar<util::BitStreamWriter>(total_frame_size * this->frame_count,
+                                                         util::PLANE_UNINITIALISED | util::PLANE_HUGE_PAGES);
 }
 
 dc::VideoDecoder::~VideoDecoder(void) {
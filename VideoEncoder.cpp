@@ -6,12 +6,12 @@
 #include <cassert>
 
 dc::VideoEncoder::VideoEncoder(const std::string &source_file, const std::string &dest_file,
-                               const uint16_t &width, const uint16_t &height, const bool &use_rle,
+                               const uint32_t &width, const uint32_t &height, const bool &use_rle,
                                MatrixReader<> &m, const uint16_t &gop, const uint16_t &merange)
     : VideoProcessor(source_file, dest_file, width, height, use_rle, m, gop, merange)
 {
-    assert(this->width  % dc::BlockSize == 0);
-    assert(this->height % dc::BlockSize == 0);
+    assert(this->width  % dc::MacroBlockSize == 0);
+    assert(this->height % dc::MacroBlockSize == 0);
     assert(this->reader->get_size() % size_t(this->frame_buffer_size + this->frame_garbage_size) == 0);
 }
 
@@ -33,14 +33,17 @@ bool dc::VideoEncoder::process(void) {
 
     // TODO
     const uint8_t quant_bit_len = this->quant_m.getMaxBitLength();
-    output_length = dc::ImageProcessor::RLE_BITS       // Bit for RLE setting
-                  + dc::ImageProcessor::DIM_BITS * 2u  // 2 times bits for video dimension
-                  + dc::MatrixReader<>::SIZE_LEN_BITS  // Bits to signify size of quant_matrix contents
-                  + (quant_bit_len                     // Size of quantmatrix
-                     * dc::BlockSize * dc::BlockSize)
-                  + dc::ImageProcessor::DIM_BITS       // Amount of frames
-                  + dc::ImageProcessor::DIM_BITS       // gop
-                  + dc::ImageProcessor::DIM_BITS       // merange
+
+    // Video dimension, amount of frames, gop and merange
+    const std::vector<size_t> fields { this->width, this->height, this->frame_count, this->gop, this->merange };
+    const bool wide = dc::ImageProcessor::needsWideFields(fields);
+
+    output_length = dc::ImageProcessor::RLE_BITS         // Bit for RLE setting
+                  + dc::MatrixReader<>::BLOCK_SIZE_BITS  // Bits to signify size of quant_matrix (and Blocks)
+                  + dc::MatrixReader<>::SIZE_LEN_BITS    // Bits to signify size of quant_matrix contents
+                  + (quant_bit_len                       // Size of quantmatrix
+                     * this->quant_m.getSize() * this->quant_m.getSize())
+                  + dc::ImageProcessor::getFieldsLength(fields.size(), wide)
                   ;
 
     util::Logger::WriteLn(std::string_format("[VideoEncoder] Settings header length: %.1f bytes.",
@@ -55,7 +58,7 @@ bool dc::VideoEncoder::process(void) {
     output_length = util::round_to_byte(output_length);  // Padding to next whole byte
 
 
-    this->writer = util::allocVar<util::BitStreamWriter>(output_length);
+    this->writer = util::allocVar<util::BitStreamWriter>(output_length, util::PLANE_UNINITIALISED | util::PLANE_HUGE_PAGES);
 
     #ifndef ENABLE_HUFFMAN
         this->writer->put_bit(0); // '0': No Huffman sequence present.
@@ -66,11 +69,7 @@ bool dc::VideoEncoder::process(void) {
 
     // Write other settings
     this->writer->put(dc::ImageProcessor::RLE_BITS, uint32_t(this->use_rle));
-    this->writer->put(dc::ImageProcessor::DIM_BITS, this->width);
-    this->writer->put(dc::ImageProcessor::DIM_BITS, this->height);
-    this->writer->put(dc::ImageProcessor::DIM_BITS, uint32_t(this->frame_count));
-    this->writer->put(dc::ImageProcessor::DIM_BITS, uint32_t(this->gop));
-    this->writer->put(dc::ImageProcessor::DIM_BITS, uint32_t(this->merange));
+    dc::ImageProcessor::writeFields(*this->writer, fields, wide);
 
     dc::MacroBlock::CreateMERLUT(this->merange);
 
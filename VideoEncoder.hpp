@@ -11,7 +11,7 @@ namespace dc {
     class VideoEncoder : public VideoProcessor {
         public:
             VideoEncoder(const std::string &source_file, const std::string &dest_file,
-                         const uint16_t &width, const uint16_t &height, const bool &use_rle,
+                         const uint32_t &width, const uint32_t &height, const bool &use_rle,
                          MatrixReader<> &m, const uint16_t &gop, const uint16_t &merange);
             ~VideoEncoder(void);
 
@@ -1,29 +1,55 @@
 #ifndef ALGO_HPP
 #define ALGO_HPP
 
+#include <array>
 #include <vector>
 #include <cstdint>
-
-// Use one implementation of:
-//#define ALGO_USE_DCT_LEE
-//#define ALGO_USE_DCT_NAIVE
-#define ALGO_USE_DCT_NAIVE_PY
+#include <cstddef>
 
 namespace algo {
     /**
-     *  Zigzag pattern data struct.
+     *  @brief  Create the zig-zag sequence for a (size*size) block at compile time,
+     *          as indices into the row-major block.
+     *
+     *  Example matrix:
+     *   0  1  2  3
+     *   4  5  6  7
+     *   8  9 10 11
+     *  12 13 14 15
+     *
+     *  Zigzag sequence:
+     *  0 1 4 8 5 2 3 6 9 12 13 10 7 11 14 15
+     *
+     *          Every anti-diagonal (x + y) is walked in turn, going down-left
+     *          on the odd ones and up-right on the even ones.
      */
-    typedef struct {
-        uint8_t group;
-        uint8_t col;
-        uint8_t x;
-        uint8_t y;
-    } Position_t;
+    template<size_t size>
+    constexpr std::array<uint16_t, size * size> createZigzagLUT(void) {
+        std::array<uint16_t, size * size> lut {};
+        size_t i = 0;
+
+        for (size_t group = 0; group < 2u * size - 1u; group++) {
+            for (size_t k = 0; k <= group; k++) {
+                const size_t x = (group & 1u) ? (group - k) : k;
+                const size_t y = (group & 1u) ? k : (group - k);
+
+                if (x < size && y < size) {
+                    lut[i++] = uint16_t(y * size + x);
+                }
+            }
+        }
+
+        return lut;
+    }
 
     /**
-     *  Zig-zag function
+     *  Zig-zag LUT for every block size, see createZigzagLUT().
      */
-    void createZigzagLUT(std::vector<algo::Position_t>&, const size_t);
+    template<size_t size>
+    inline constexpr std::array<uint16_t, size * size> ZigZagLUT = algo::createZigzagLUT<size>();
+
+    static_assert(algo::ZigZagLUT<4>[3] == 8u && algo::ZigZagLUT<4>[12] == 7u && algo::ZigZagLUT<4>[15] == 15u,
+                  "Unexpected zig-zag sequence");
 
 
     static constexpr uint8_t MER_PATTERN_SIZE = 9u;  ///< Corners and sides on diamond pattern.
@@ -33,8 +59,8 @@ namespace algo {
      */
     struct MER_level_t {
         uint8_t depth;
-        int16_t x0;
-        int16_t y0;
+        int32_t x0;
+        int32_t y0;
         MER_level_t *points;
     };
 
@@ -54,13 +80,6 @@ namespace algo {
         uint8_t data_bits;
         int16_t data;
     } RLE_data_t;
-
-
-    /**
-     *  DCT functions
-     */
-    void transformDCT(double[], const size_t);
-    void transformDCTinverse(double[], const std::size_t);
 }
 
 #endif // ALGO_HPP
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <sstream>
+#include <vector>
 
 #include "main.hpp"
 #include "utils.hpp"
@@ -6,13 +8,22 @@
 
 #include "ConfigReader.hpp"
 #include "MatrixReader.hpp"
+#include "Transform.hpp"
 
 #ifdef ENCODER
     #include "ImageEncoder.hpp"
+    #include "StripEncoder.hpp"
+    #include "PyramidEncoder.hpp"
+    #include "Transcoder.hpp"
+    #include "LosslessTransformer.hpp"
+    #include "IncrementalEncoder.hpp"
     #include "VideoEncoder.hpp"
 #endif
 #ifdef DECODER
     #include "ImageDecoder.hpp"
+    #include "StripDecoder.hpp"
+    #include "PyramidDecoder.hpp"
+    #include "EncodedImage.hpp"
     #include "VideoDecoder.hpp"
 #endif
 
@@ -61,6 +72,9 @@ int main(int argc, char *argv[]) {
     util::Logger::WriteLn("-------------------------", false);
     util::Logger::WriteLn(c.toString(), false);
 
+    // Unknown backends fall back to selection by CPU features, so the error is not fatal.
+    algo::selectTransformBackend(c.getValue(dc::ExtraSetting::dctbackend));
+
     const std::string encfile = c.getValue(dc::ImageSetting::encfile),
                       decfile = c.getValue(dc::ImageSetting::decfile);
 
@@ -85,13 +99,47 @@ int main(int argc, char *argv[]) {
         util::Logger::WriteLn("-------------------------", false);
         util::Logger::WriteLn(m.toString(), false);
 
-        uint16_t width, height, rle, gop, merange;
+        uint32_t width, height, blockindex = 0u, tile = 0u;
+        uint16_t rle, gop, merange, adaptive = 0u, strip = 0u, progressive = 0u, pyramid = 0u, dedup = 0u;
 
         try {
-            width  = util::lexical_cast<uint16_t>(c.getValue(dc::ImageSetting::width).c_str());
-            height = util::lexical_cast<uint16_t>(c.getValue(dc::ImageSetting::height).c_str());
+            width  = util::lexical_cast<uint32_t>(c.getValue(dc::ImageSetting::width).c_str());
+            height = util::lexical_cast<uint32_t>(c.getValue(dc::ImageSetting::height).c_str());
             rle    = util::lexical_cast<uint16_t>(c.getValue(dc::ImageSetting::rle).c_str());
 
+            if (!c.getValue(dc::ExtraSetting::adaptive).empty()) {
+                adaptive = util::lexical_cast<uint16_t>(c.getValue(dc::ExtraSetting::adaptive).c_str());
+            }
+
+            // An index entry every N Blocks, or "row" for one entry per row of Blocks
+            const std::string index_setting = c.getValue(dc::ExtraSetting::blockindex);
+
+            if (index_setting == "row") {
+                blockindex = uint32_t(width / m.getSize());
+            } else if (!index_setting.empty()) {
+                blockindex = util::lexical_cast<uint32_t>(index_setting.c_str());
+            }
+
+            if (!c.getValue(dc::ExtraSetting::strip).empty()) {
+                strip = util::lexical_cast<uint16_t>(c.getValue(dc::ExtraSetting::strip).c_str());
+            }
+
+            if (!c.getValue(dc::ExtraSetting::tile).empty()) {
+                tile = util::lexical_cast<uint32_t>(c.getValue(dc::ExtraSetting::tile).c_str());
+            }
+
+            if (!c.getValue(dc::ExtraSetting::progressive).empty()) {
+                progressive = util::lexical_cast<uint16_t>(c.getValue(dc::ExtraSetting::progressive).c_str());
+            }
+
+            if (!c.getValue(dc::ExtraSetting::pyramid).empty()) {
+                pyramid = util::lexical_cast<uint16_t>(c.getValue(dc::ExtraSetting::pyramid).c_str());
+            }
+
+            if (!c.getValue(dc::ExtraSetting::dedup).empty()) {
+                dedup = util::lexical_cast<uint16_t>(c.getValue(dc::ExtraSetting::dedup).c_str());
+            }
+
             if (input_is_encvideo) {
                 gop        = util::lexical_cast<uint16_t>(c.getValue(dc::VideoSetting::gop).c_str());
                 merange    = util::lexical_cast<uint16_t>(c.getValue(dc::VideoSetting::merange).c_str());
@@ -101,8 +149,135 @@ int main(int argc, char *argv[]) {
             return 5;
         }
 
-        if (input_is_image) {
-            dc::ImageEncoder enc(rawfile, encfile, width, height, rle, m);
+        // An encoded image to requantise with the quant matrix, instead of encoding the raw file
+        const std::string transcode = c.getValue(dc::ExtraSetting::transcode);
+
+        if (input_is_image && !transcode.empty()) {
+            if (transcode == encfile) {
+                std::cerr << "Error in settings! Encoded filename must be different from the transcoded file!" << std::endl;
+                return 3;
+            }
+
+            // Changing the orientation or cropping keeps the quantization, else requantise with the quant matrix
+            const std::string orient = c.getValue(dc::ExtraSetting::orient);
+            std::vector<size_t> crop;   // x, y, width, height
+
+            try {
+                std::stringstream crop_setting(c.getValue(dc::ExtraSetting::crop));
+
+                for (std::string value; std::getline(crop_setting, value, ',');) {
+                    crop.push_back(util::lexical_cast<size_t>(value.c_str()));
+                }
+            } catch (Exceptions::CastingException const& e) {
+                util::Logger::WriteLn(e.getMessage());
+                return 5;
+            }
+
+            if (!crop.empty() && crop.size() != 4u) {
+                std::cerr << "Error in settings! Crop should be \"x,y,width,height\"!" << std::endl;
+                return 3;
+            }
+
+            if (!orient.empty() || !crop.empty()) {
+                const dc::Orientation orientation = orient.empty()
+                                                  ? dc::Orientation::none
+                                                  : dc::LosslessTransformer::ParseOrientation(orient);
+                const dc::TileRect area = crop.empty()
+                                        ? dc::TileRect { 0u, 0u, 0u, 0u }
+                                        : dc::TileRect { crop[0], crop[1], crop[2], crop[3] };
+
+                dc::LosslessTransformer enc(transcode, encfile, orientation, area);
+
+                if ((success = enc.process())) {
+                    enc.saveResult();
+
+                    util::Logger::WriteLn("", false);
+                    util::Logger::WriteLn(std::string_format("Elapsed time: %f milliseconds",
+                                                             util::TimerDuration_ms(start)));
+                    util::Logger::WriteLn("", false);
+                    util::Logger::WriteLn("", false);
+                } else {
+                    util::Logger::WriteLn("Error processing encoded image for transforming! See log for details.");
+                }
+            } else {
+                dc::Transcoder enc(transcode, encfile, m);
+
+                if ((success = enc.process())) {
+                    enc.saveResult();
+
+                    util::Logger::WriteLn("", false);
+                    util::Logger::WriteLn(std::string_format("Elapsed time: %f milliseconds",
+                                                             util::TimerDuration_ms(start)));
+                    util::Logger::WriteLn("", false);
+                    util::Logger::WriteLn("", false);
+                } else {
+                    util::Logger::WriteLn("Error processing encoded image for transcoding! See log for details.");
+                }
+            }
+        } else if (input_is_image && !c.getValue(dc::ExtraSetting::incremental).empty()) {
+            // The previous raw image and its encoded file, only the Blocks that changed since are encoded
+            std::stringstream incremental_setting(c.getValue(dc::ExtraSetting::incremental));
+            std::string previous_raw, previous_enc;
+
+            if (!std::getline(incremental_setting, previous_raw, ',') || !std::getline(incremental_setting, previous_enc)) {
+                std::cerr << "Error in settings! Incremental should be \"previous.raw,previous.enc\"!" << std::endl;
+                return 3;
+            }
+
+            if (previous_enc == encfile) {
+                std::cerr << "Error in settings! Encoded filename must be different from the previous encoded file!" << std::endl;
+                return 3;
+            }
+
+            dc::IncrementalEncoder enc(previous_raw, previous_enc, rawfile, encfile);
+
+            if ((success = enc.process())) {
+                enc.saveResult();
+
+                util::Logger::WriteLn("", false);
+                util::Logger::WriteLn(std::string_format("Elapsed time: %f milliseconds",
+                                                         util::TimerDuration_ms(start)));
+                util::Logger::WriteLn("", false);
+                util::Logger::WriteLn("", false);
+            } else {
+                util::Logger::WriteLn("Error processing raw image for incremental encoding! See log for details.");
+            }
+        } else if (input_is_image && strip != 0u) {
+            if (adaptive != 0u || blockindex != 0u || tile != 0u || progressive != 0u || dedup != 0u) {
+                util::Logger::WriteLn("The adaptive, blockindex, tile, progressive and dedup settings are ignored with strip.");
+            }
+
+            dc::StripEncoder enc(rawfile, encfile, width, height, rle, m, strip);
+
+            if ((success = enc.process())) {
+                enc.saveResult();
+
+                util::Logger::WriteLn("", false);
+                util::Logger::WriteLn(std::string_format("Elapsed time: %f milliseconds",
+                                                         util::TimerDuration_ms(start)));
+                util::Logger::WriteLn("", false);
+                util::Logger::WriteLn("", false);
+            } else {
+                util::Logger::WriteLn("Error processing raw image for encoding! See log for details.");
+            }
+        } else if (input_is_image && pyramid != 0u) {
+            dc::PyramidEncoder enc(rawfile, encfile, width, height, rle, m, pyramid, adaptive, blockindex, tile, progressive,
+                                   uint8_t(std::min(dedup, uint16_t(2u))));
+
+            if ((success = enc.process())) {
+                enc.saveResult();
+
+                util::Logger::WriteLn("", false);
+                util::Logger::WriteLn(std::string_format("Elapsed time: %f milliseconds",
+                                                         util::TimerDuration_ms(start)));
+                util::Logger::WriteLn("", false);
+                util::Logger::WriteLn("", false);
+            } else {
+                util::Logger::WriteLn("Error processing raw image for encoding! See log for details.");
+            }
+        } else if (input_is_image) {
+            dc::ImageEncoder enc(rawfile, encfile, width, height, rle, m, adaptive, blockindex, tile, progressive,
+                                 uint8_t(std::min(dedup, uint16_t(2u))));
 
             if ((success = enc.process())) {
                 enc.saveResult();
@@ -141,12 +316,105 @@ int main(int argc, char *argv[]) {
         if (success) {
             start = util::TimerStart();
 
-            if (input_is_image) {
-                dc::ImageDecoder dec(encfile, decfile);
+            uint16_t strip = 0u, scale = 1u, level = 0u;
+            const bool pyramid = !c.getValue(dc::ExtraSetting::pyramid).empty();
+            std::vector<size_t> region;     // x, y, width, height
+            std::vector<size_t> sample;     // x, y of every pixel
+
+            try {
+                if (!c.getValue(dc::ExtraSetting::strip).empty()) {
+                    strip = util::lexical_cast<uint16_t>(c.getValue(dc::ExtraSetting::strip).c_str());
+                }
+
+                if (!c.getValue(dc::ExtraSetting::level).empty()) {
+                    level = util::lexical_cast<uint16_t>(c.getValue(dc::ExtraSetting::level).c_str());
+                }
+
+                if (!c.getValue(dc::ExtraSetting::scale).empty()) {
+                    scale = util::lexical_cast<uint16_t>(c.getValue(dc::ExtraSetting::scale).c_str());
+                }
+
+                // Region as "x,y,width,height"
+                std::stringstream region_setting(c.getValue(dc::ExtraSetting::region));
+
+                for (std::string value; std::getline(region_setting, value, ',');) {
+                    region.push_back(util::lexical_cast<size_t>(value.c_str()));
+                }
+
+                // Pixels as "x,y[,x,y...]"
+                std::stringstream sample_setting(c.getValue(dc::ExtraSetting::sample));
+
+                for (std::string value; std::getline(sample_setting, value, ',');) {
+                    sample.push_back(util::lexical_cast<size_t>(value.c_str()));
+                }
+            } catch (Exceptions::CastingException const& e) {
+                util::Logger::WriteLn(e.getMessage());
+                return 5;
+            }
+
+            if (sample.size() % 2u != 0u) {
+                std::cerr << "Error in settings! Sample should be \"x,y[,x,y...]\"!" << std::endl;
+                return 3;
+            }
+
+            if (input_is_image && !sample.empty()) {
+                dc::EncodedImage img(encfile);
+
+                if (img.process()) {
+                    for (size_t i = 0; i < sample.size(); i += 2u) {
+                        uint8_t value;
+
+                        if (img.getPixel(sample[i], sample[i + 1u], value)) {
+                            util::Logger::WriteLn(std::string_format("Pixel (%d, %d): %d", sample[i], sample[i + 1u], value));
+                        } else {
+                            util::Logger::WriteLn(std::string_format("Pixel (%d, %d) is outside the %dx%d image!",
+                                                                     sample[i], sample[i + 1u], img.getWidth(), img.getHeight()));
+                        }
+                    }
+
+                    util::Logger::WriteLn("", false);
+                    util::Logger::WriteLn(std::string_format("Decoded %d Blocks in %f milliseconds",
+                                                             img.getDecodedBlocks(), util::TimerDuration_ms(start)));
+                    util::Logger::WriteLn("", false);
+                } else {
+                    util::Logger::Write("Error processing encoded image for sampling! See log for details.");
+                }
+            } else if (input_is_image && strip != 0u) {
+                dc::StripDecoder dec(encfile, decfile, strip);
 
                 if (dec.process()) {
                     dec.saveResult();
 
+                    util::Logger::WriteLn("", false);
+                    util::Logger::WriteLn(std::string_format("Elapsed time: %f milliseconds",
+                                                             util::TimerDuration_ms(start)));
+                    util::Logger::WriteLn("", false);
+                } else {
+                    util::Logger::Write("Error processing raw image for decoding! See log for details.");
+                }
+            } else if (input_is_image && pyramid) {
+                dc::PyramidDecoder dec(encfile, decfile);
+
+                if (dec.process(level)) {
+                    dec.saveResult();
+
+                    util::Logger::WriteLn("", false);
+                    util::Logger::WriteLn(std::string_format("Elapsed time: %f milliseconds",
+                                                             util::TimerDuration_ms(start)));
+                    util::Logger::WriteLn("", false);
+                } else {
+                    util::Logger::Write("Error processing raw image for decoding! See log for details.");
+                }
+            } else if (input_is_image) {
+                dc::ImageDecoder dec(encfile, decfile);
+
+                const bool decoded = (region.size() == 4u)
+                                   ? dec.processRegion(dc::TileRect { region[0], region[1], region[2], region[3] })
+                                   : (scale != 1u ? dec.processScaled(scale) : dec.process());
+
+                if (decoded) {
+                    dec.saveResult();
+
                     util::Logger::WriteLn("", false);
                     util::Logger::WriteLn(std::string_format("Elapsed time: %f milliseconds",
                                                              util::TimerDuration_ms(start)));
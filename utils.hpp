@@ -11,11 +11,17 @@
 #include <sstream>
 #include <memory>
 #include <chrono>
+#include <new>
+
+#include <cstdlib>
+#include <cstring>
 
 #ifdef _MSC_VER
     #include <intrin.h>
+    #include <malloc.h>
 #else
     #include <cxxabi.h>
+    #include <sys/mman.h>
 
     #if __cplusplus < 201703L
     #error A C++17 compiler is required!
@@ -208,6 +214,11 @@ namespace util {
      *      Index of least significat bit at one
      */
     [[maybe_unused]] static inline uint8_t ffs(uint32_t value ) {
+        if (value == 0) {
+            // __builtin_clz(0) is undefined
+            return 0u;
+        }
+
         #ifdef _MSC_VER
             return uint8_t(32 - __lzcnt(value));
         #else
@@ -336,45 +347,6 @@ namespace util {
     }
 
 
-    /**
-     *	\brief	Read the given file and return a pointer to a list containing its contents in binary data (raw chars).
-     *
-     *	\param	filename
-     *		The (path and) name of the file to read.
-     *
-     *	\return	std::vector<char>*
-     *			A vector with buffer->size() bytes containing a program in raw binary.
-     *			Print with cast to (unsigned char) for proper viewing.
-     *
-     *	\exception	FileReadException
-     *		Throws FileReadException if the file could not be read properly.
-     */
-    [[maybe_unused]] static inline std::vector<uint8_t>* readBinaryFile(const std::string &filename) {
-        std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
-
-        if (!file.good()) {
-            file.close();
-            throw Exceptions::FileReadException(filename);
-        }
-
-        std::vector<uint8_t> *v_buff = new std::vector<uint8_t>();
-
-        try {
-            // Filepointer is already at end due to ::ate option, so tellg() gives filesize
-            v_buff->reserve(size_t(file.tellg()));
-            file.seekg(0, std::ios::beg);
-            v_buff->assign((std::istreambuf_iterator<char>(file)),
-                            std::istreambuf_iterator<char>());
-        } catch (...) {
-            delete v_buff;
-            file.close();
-            throw Exceptions::FileReadException(filename);
-        }
-
-        file.close();
-        return v_buff;
-    }
-
     /**
      *	\brief	Write the given char buffer to the given file.
      *
@@ -457,6 +429,146 @@ namespace util {
         delete[] a;
     }
 
+    /**
+     *  @brief  Options for util::allocPlane().
+     */
+    enum PlaneFlag : uint8_t {
+        PLANE_ZEROED        = 0u,       ///< Zero-initialise the plane, like util::allocArray() (default).
+        PLANE_UNINITIALISED = 1u << 0,  ///< Skip zero-initialisation, for buffers that are overwritten anyway.
+        PLANE_HUGE_PAGES    = 1u << 1,  ///< Back large planes with transparent huge pages (if supported).
+    };
+
+    static constexpr size_t PLANE_ALIGNMENT = 64u;          ///< Alignment of every plane in bytes.
+    static constexpr size_t HUGE_PAGE_SIZE  = 2u << 20;     ///< Size of a transparent huge page in bytes.
+
+    /**	\brief	Allocate a plane (large array) of objects of type T and length x,
+     *          aligned to util::PLANE_ALIGNMENT bytes.
+     *          With util::PLANE_HUGE_PAGES, planes of at least util::HUGE_PAGE_SIZE bytes are aligned
+     *          to a huge page and marked with madvise(MADV_HUGEPAGE), to reduce TLB misses
+     *          and page faults on large frames.
+     *
+     *	\tparam	T
+     *		The type of object to allocate, should be trivial.
+     *	\param	x
+     *		The length of the plane.
+     *	\param	flags
+     *		A combination of util::PlaneFlag values.
+     *	\return
+     *		A pointer to the newly allocated plane, deallocate with util::deallocPlane().
+     */
+    template <class T>
+    [[maybe_unused]] static inline T* allocPlane(size_t x, uint8_t flags = util::PLANE_ZEROED) {
+        static_assert(std::is_trivial<T>::value, "Planes are only supported for trivial types!");
+
+        const size_t bytes     = std::max<size_t>(x * sizeof(T), 1u);
+        const bool   huge      = (flags & util::PLANE_HUGE_PAGES) && bytes >= util::HUGE_PAGE_SIZE;
+        const size_t alignment = huge ? util::HUGE_PAGE_SIZE : util::PLANE_ALIGNMENT;
+        const size_t length    = (bytes + alignment - 1u) / alignment * alignment;  // Multiple of alignment
+
+        #ifdef _MSC_VER
+            void *plane = _aligned_malloc(length, alignment);
+        #else
+            void *plane = std::aligned_alloc(alignment, length);
+        #endif
+
+        if (plane == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        #ifdef MADV_HUGEPAGE
+            if (huge) {
+                // Only a hint, the plane works without huge pages as well
+                madvise(plane, length, MADV_HUGEPAGE);
+            }
+        #endif
+
+        if (!(flags & util::PLANE_UNINITIALISED)) {
+            std::memset(plane, 0, length);
+        }
+
+        return static_cast<T*>(plane);
+    }
+
+    /**	\brief	Deallocate a plane of type T that was allocated using util::allocPlane<T>(size_t, uint8_t).
+     *
+     *	\tparam	T
+     *		The type of object to deallocate.
+     *	\param	*a
+     *		A pointer to the plane to deallocate.
+     */
+    template <class T>
+    [[maybe_unused]] static inline void deallocPlane(T* a) {
+        #ifdef _MSC_VER
+            _aligned_free(a);
+        #else
+            std::free(a);
+        #endif
+    }
+
+    /**	\brief	Reallocate the given plane to a new plane with different size.
+     *          Elements will be copied to the new plane.
+     *
+     *	\tparam	T
+     *		The type of object to allocate.
+     *	\param	*&a
+     *		A reference to a pointer to the plane to reallocate.
+     *	\param	&old_size
+     *		The old length of the plane, by reference.
+     *      old_size will contain the new length after reallocation.
+     *	\param	new_size
+     *		The new length of the plane.
+     *	\param	flags
+     *		A combination of util::PlaneFlag values for the new plane.
+     */
+    template <class T>
+    [[maybe_unused]] static inline void reallocPlane(T*& a, size_t& old_size, size_t new_size, uint8_t flags = util::PLANE_ZEROED) {
+        T* new_plane = util::allocPlane<T>(new_size, flags);
+        std::copy_n(a, std::min(old_size, new_size), new_plane);
+        util::deallocPlane(a);
+        a = new_plane;
+        old_size = new_size;
+    }
+
+    /**
+     *	\brief	Read the given file into a plane containing its contents in binary data (raw chars).
+     *
+     *	\param	filename
+     *		The (path and) name of the file to read.
+     *	\param	length
+     *		Will contain the length of the plane in bytes.
+     *
+     *	\return	uint8_t*
+     *			A plane with length bytes, deallocate with util::deallocPlane().
+     *
+     *	\exception	FileReadException
+     *		Throws FileReadException if the file could not be read properly.
+     */
+    [[maybe_unused]] static inline uint8_t* readBinaryFile(const std::string &filename, size_t &length) {
+        std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+
+        if (!file.good()) {
+            file.close();
+            throw Exceptions::FileReadException(filename);
+        }
+
+        // Filepointer is already at end due to ::ate option, so tellg() gives filesize
+        length = size_t(file.tellg());
+
+        // Every byte is read from the file, so the plane needs no initialisation
+        uint8_t *plane = util::allocPlane<uint8_t>(length, util::PLANE_UNINITIALISED | util::PLANE_HUGE_PAGES);
+
+        file.seekg(0, std::ios::beg);
+
+        if (!file.read(reinterpret_cast<char*>(plane), std::streamsize(length))) {
+            util::deallocPlane(plane);
+            file.close();
+            throw Exceptions::FileReadException(filename);
+        }
+
+        file.close();
+        return plane;
+    }
+
     /**	\brief	Reallocate the given array to a new array with different size.
      *          Elements will be copied to the new array.
      *